@@ -16,6 +16,10 @@ public:
 
 	virtual bool isOpaque() const noexcept { return true; }
 	virtual bool isSideSolid(Facing3) const noexcept { return isOpaque(); }
+	/**
+	 * @brief Block light emitted by this block, from 0 to 15.
+	 */
+	virtual int getLightEmission() const noexcept { return 0; }
 };
 
 class BlockNull final: public Block
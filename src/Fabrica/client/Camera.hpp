@@ -60,6 +60,15 @@ public:
 	float getZ() const noexcept { return position.z; }
 	float getYaw() const noexcept { return yaw; }
 	float getPitch() const noexcept { return pitch; }
+	/**
+	 * @brief Unit vector in the direction the camera is facing.
+	 */
+	Vector3f getDirection() const noexcept
+	{
+		return Vector3f(std::sin(yaw) * std::cos(pitch),
+		                -std::sin(pitch),
+		                -std::cos(yaw) * std::cos(pitch));
+	}
 private:
 	float yaw, pitch;
 	glm::vec3 position;
@@ -21,7 +21,8 @@ Client::Client(ClientConfig* const config):
 	debugScreen(&Font::defaultFont()),
 
 	textureManager(nullptr),
-	worldRenderer(nullptr)
+	worldRenderer(nullptr),
+	world(nullptr)
 {
 }
 Client::~Client()
@@ -30,18 +31,20 @@ Client::~Client()
 	delete worldRenderer;
 }
 
-void Client::reloadRenderers()
+void Client::reloadRenderers(boost::filesystem::path const& atlasCache)
 {
 	delete textureManager;
-	textureManager = RenderingRegistry::initAll();
+	textureManager = RenderingRegistry::initAll(
+	  atlasCache, (std::size_t) config->textureMemoryBudget << 20);
 }
 void Client::loadWorld(World* world)
 {
 	assert(!worldRenderer);
 	logger("Loading... World");
+	this->world = world;
+	world->setMemoryBudget((std::size_t) config->chunkMemoryBudget << 20);
 	worldRenderer = new WorldRenderer(window,
 	                                  world,
-	                                  &mutexWorld,
 	                                  &interactions,
 	                                  textureManager);
 	window->pushListener(worldRenderer);
@@ -57,6 +60,20 @@ void Client::execDraw()
 	logger("Drawing loop begin");
 	Camera camera;
 	camera.setPosition(0.f, 20.f, 0.f);
+	// The camera is a box of 0.6 x 1.8 blocks with the eye 1.6 above its base.
+	Vector3f const eyeMin(-0.3f, -1.6f, -0.3f);
+	Vector3f const eyeMax(0.3f, 0.2f, 0.3f);
+	if (world)
+	{
+		// Start on the surface
+		WorldLocks::Region guard(world->getLocks(),
+		                         Vector3i(0, 0, 0),
+		                         Vector3i(0, World::chunkYMax - 1, 0),
+		                         WorldLocks::READ);
+		int const height = world->getHeight(0, 0, Heightmap::MOTION_BLOCKING);
+		if (height > 0)
+			camera.setPosition(0.5f, height - eyeMin.y(), 0.5f);
+	}
 
 	logger("Camera Position: [" +
 	       std::to_string(camera.getX()) + ", " +
@@ -83,8 +100,7 @@ void Client::execDraw()
 
 			float const duration = pmonitor.getDuration();
 
-			mutexWorld.lock();
-
+			Vector3f const before(camera.getX(), camera.getY(), camera.getZ());
 			if (interactions.moveFront)
 				camera.translatePara(config->naviSpeedPara * duration);
 			else if (interactions.moveBack)
@@ -97,6 +113,22 @@ void Client::execDraw()
 				camera.translateVert(config->naviSpeedVert * duration);
 			if (interactions.moveDown)
 				camera.translateVert(-config->naviSpeedVert * duration);
+			// Stop the camera at solid blocks
+			Vector3f const after(camera.getX(), camera.getY(), camera.getZ());
+			Vector3f moved;
+			{
+				Vector3f const margin(1.f, 1.f, 1.f);
+				WorldLocks::Region guard(
+				  world->getLocks(),
+				  World::chunkOf(before.cwiseMin(after) + eyeMin - margin),
+				  World::chunkOf(before.cwiseMax(after) + eyeMax + margin),
+				  WorldLocks::READ);
+				moved = world->slide(AABB{before + eyeMin, before + eyeMax},
+				                     after - before);
+			}
+			camera.setPosition(before.x() + moved.x(),
+			                   before.y() + moved.y(),
+			                   before.z() + moved.z());
 
 			double cursorX, cursorY;
 			window->getCursor(&cursorX, &cursorY);
@@ -106,7 +138,6 @@ void Client::execDraw()
 			                   Window::instance().getHeight());
 
 			showDebugScreen = interactions.showDebugScreen;
-			mutexWorld.unlock();
 
 			worldRenderer->draw(camera);
 		}
@@ -118,12 +149,16 @@ void Client::execDraw()
 			debugScreen.setFPS(pmonitor.getFPS());
 			debugScreen.setCameraData(camera);
 			debugScreen.setWireframe(interactions.drawWireframe);
+			debugScreen.setResidency(worldRenderer->getResidencyStats());
+			debugScreen.setMeshing(worldRenderer->getMeshStats());
+			debugScreen.setLocks(world->getLocks().stats());
 			debugScreen.updateGeometry();
 			debugScreen.draw();
 		}
 		GL_ERROR_CHECK;
 
 		window->swapBuffers();
+		if (worldRenderer) worldRenderer->onPresent();
 		window->pollEvents();
 
 		if (!window->isOpen()) living = false;
@@ -2,7 +2,6 @@
 #define FABRICA_CLIENT_CLIENT_HPP_
 
 #include <atomic>
-#include <mutex>
 
 #include <boost/core/noncopyable.hpp>
 #include <boost/filesystem.hpp>
@@ -31,7 +30,12 @@ public:
 
 	void halt() { living = false; }
 
-	void reloadRenderers();
+	/**
+	 * @param[in] atlasCache File caching the block atlas, see
+	 *  {@code RenderingRegistry::initAll}.
+	 */
+	void reloadRenderers(boost::filesystem::path const& atlasCache =
+	                       boost::filesystem::path());
 	/**
 	 * @warning Must not be called when a world is already loaded.
 	 */
@@ -54,7 +58,7 @@ private:
 	TextureManager* textureManager;
 	WorldRenderer* worldRenderer;
 
-	std::mutex mutexWorld;
+	World* world;
 	InteractionFlags interactions;
 };
 
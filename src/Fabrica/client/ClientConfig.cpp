@@ -12,6 +12,9 @@ void ClientConfig::read()
 	naviSpeedPerp = 5.f;
 	naviSpeedVert = 8.f;
 
+	chunkMemoryBudget = 512;
+	textureMemoryBudget = 64;
+
 	if(!c.fileRead()) return;
 
 	if (c.readSubtree("navigation"))
@@ -22,6 +25,13 @@ void ClientConfig::read()
 
 		c.popSubtree();
 	}
+	if (c.readSubtree("memory"))
+	{
+		c.read(&chunkMemoryBudget, "Chunk_Memory_Budget");
+		c.read(&textureMemoryBudget, "Texture_Memory_Budget");
+
+		c.popSubtree();
+	}
 	c.popSubtree();
 }
 void ClientConfig::write()
@@ -36,6 +46,13 @@ void ClientConfig::write()
 	}
 	c.endSubtree("navigation");
 
+	c.beginSubtree();
+	{
+		c.write(chunkMemoryBudget, "Chunk_Memory_Budget");
+		c.write(textureMemoryBudget, "Texture_Memory_Budget");
+	}
+	c.endSubtree("memory");
+
 	c.fileWrite();
 	c.popSubtree();
 }
@@ -28,6 +28,8 @@ public:
 	float naviSpeedPara;
 	float naviSpeedPerp;
 	float naviSpeedVert;
+	int chunkMemoryBudget; ///< In MiB
+	int textureMemoryBudget; ///< In MiB, video memory for block textures
 
 private:
 	Configuration c;
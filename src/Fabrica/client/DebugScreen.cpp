@@ -1,7 +1,8 @@
 #include "DebugScreen.hpp"
 
-#include <sstream>
-#include <iomanip>
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
 
 #include "Window.hpp"
 #include "renderer/utils.hpp"
@@ -13,32 +14,72 @@ DebugScreen::DebugScreen(Font const* const font):
 	text(font), wireframe(false),
 
 	fps(0.f), camX(0.f), camY(0.f), camZ(0.f),
-	camYaw(0.f), camPitch(0.f)
+	camYaw(0.f), camPitch(0.f),
+	showResidency(false), residency(),
+	showMeshing(false), meshing(),
+	showLocks(false), locks()
 {
 }
 
 void DebugScreen::updateGeometry()
 {
-	std::stringstream string;
-	string << std::fixed << std::setprecision(1);
+	// Reuses the capacity of the string, so a frame allocates nothing.
+	string.clear();
 
 	// Window
-	string << "Window: [" << Window::instance().getWidth()
-	       << ", " << Window::instance().getHeight() << "]";
-	if (wireframe) string << " in Wireframe";
+	append("Window: [%d, %d]", Window::instance().getWidth(),
+	       Window::instance().getHeight());
+	if (wireframe) string += " in Wireframe";
 
 	// FPS
-	string << " FPS: " << fps;
-	
+	append(" FPS: %.1f", fps);
+
 	// Camera
-	string << "\nCamera: [" << camX << ", " << camY << ", " << camZ
-	       << "], [" << camYaw << ", " << camPitch << "]";
+	append("\nCamera: [%.1f, %.1f, %.1f], [%.1f, %.1f]",
+	       camX, camY, camZ, camYaw, camPitch);
+
+	// Chunk residency
+	if (showResidency)
+	{
+		append("\nColumns: %zu, %.1f/%.1f MiB, H/M/E: %llu/%llu/%llu",
+		       residency.nColumns,
+		       residency.bytes / 1048576.f, residency.budget / 1048576.f,
+		       (unsigned long long) residency.hits,
+		       (unsigned long long) residency.misses,
+		       (unsigned long long) residency.evictions);
+	}
+	// Meshing
+	if (showMeshing)
+	{
+		append("\nMeshes: %d, Streaming: %d, Edit latency: %.1f ms",
+		       meshing.nMeshes, meshing.nStreaming, meshing.editLatency);
+	}
+	// World locks
+	if (showLocks)
+	{
+		append("\nLocks: %llu/%llu contended, %.1f ms waiting",
+		       (unsigned long long) locks.contended,
+		       (unsigned long long) locks.acquisitions,
+		       locks.waitNs / 1e6f);
+	}
 
-	text.setContents(-1.f, 1.f, Text::TOP_LEFT, string.str());
+	// Only the lines that changed are laid out again.
+	text.setContents(-1.f, 1.f, Text::TOP_LEFT, string);
 }
 void DebugScreen::draw()
 {
 	text.draw();
 }
 
+void DebugScreen::append(char const* format, ...)
+{
+	char buffer[256];
+	std::va_list args;
+	va_start(args, format);
+	int n = std::vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+	if (n > 0)
+		string.append(buffer, std::min<std::size_t>(n, sizeof(buffer) - 1));
+}
+
 } // namespace fab
@@ -3,6 +3,8 @@
 
 #include "renderer/Text.hpp"
 #include "Camera.hpp"
+#include "WorldRenderer.hpp"
+#include "../world/ChunkResidency.hpp"
 
 namespace fab
 {
@@ -25,20 +27,53 @@ public:
 		fps = val;
 	}
 
+	void setResidency(ResidencyStats const& val) noexcept
+	{
+		residency = val;
+		showResidency = true;
+	}
+
+	void setMeshing(MeshStats const& val) noexcept
+	{
+		meshing = val;
+		showMeshing = true;
+	}
+
+	void setLocks(LockStats const& val) noexcept
+	{
+		locks = val;
+		showLocks = true;
+	}
+
 	/**
 	 * @brief Loads camera data into DebugScreen.
 	 */
 	void setCameraData(Camera const& camera) noexcept;
 
+	/**
+	 * @brief Formats the debug data and lays out the lines of it that changed.
+	 */
 	void updateGeometry();
 	void draw();
 private:
+	/**
+	 * @brief Appends printf-style formatted text to string.
+	 */
+	void append(char const* format, ...);
+
 	Text text;
+	String string; ///< Formatted debug data, reused between frames
 
 	bool wireframe;
 	float fps;
 	float camX, camY, camZ;
 	float camYaw, camPitch;
+	bool showResidency;
+	ResidencyStats residency;
+	bool showMeshing;
+	MeshStats meshing;
+	bool showLocks;
+	LockStats locks;
 };
 
 // Implementations
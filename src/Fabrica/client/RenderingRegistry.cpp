@@ -1,23 +1,82 @@
 #include "RenderingRegistry.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "renderer/AtlasCache.hpp"
+#include "renderer/utils.hpp"
+
 namespace fab
 {
 
 std::map<Block*, RenderBlock*> RenderingRegistry::renderBlocks;
 
-TextureManager* RenderingRegistry::initAll()
+TextureManager*
+RenderingRegistry::initAll(boost::filesystem::path const& cache,
+                           std::size_t budget,
+                           unsigned int nThreads)
 {
-	TextureManager* tm = new TextureManager();
-
-	tm->getTextureBlock().loadTexture();
-	int index = 0;
-	auto blockTextureLoader = [&index, tex = &tm->getTextureBlock()](void* pixels)
+	// Assigns the charts first, so that the atlas is allocated once.
+	std::map<ResourceLocation, int> charts;
+	std::vector<ResourceLocation const*> textures;
+	auto blockTextureRegistry = [&charts, &textures](ResourceLocation const& rl)
 	{
-		tex->loadChart(index, pixels);
-		return index++;
+		auto const inserted = charts.emplace(rl, (int) textures.size());
+		if (inserted.second)
+			textures.push_back(&inserted.first->first);
+		return inserted.first->second;
 	};
 	for (auto& r: renderBlocks)
-		r.second->loadTextures(tm->getBlockSize(), blockTextureLoader);
+		r.second->loadTextures(blockTextureRegistry);
+
+	// Only the headers are read, to size the charts.
+	int sourceSize = 0;
+	for (auto const* rl: textures)
+	{
+		int width, height;
+		if (readTextureSizePNG(*rl, &width, &height))
+			sourceSize = std::max({sourceSize, width, height});
+	}
+	GLint maxTextureSize;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	int const size = TextureManager::blockSizeFor(textures.size(), sourceSize,
+	                                              budget, maxTextureSize);
+	TextureManager* tm = new TextureManager(textures.size(), size);
+	std::size_t const chartBytes = size * size * 4; // 4 channels, RGBA
+
+	AtlasCache atlasCache(cache);
+	std::uint64_t const key = AtlasCache::key(textures, size);
+	if (!cache.empty() && atlasCache.open(key, textures, size))
+	{
+		tm->getTextureBlock().loadTexture();
+		tm->getTextureBlock().loadCharts(0, textures.size(),
+		                                 atlasCache.getPixels());
+		return tm;
+	}
+
+	// Decoding dominates, and each texture is independent.
+	std::size_t const n = textures.size();
+	std::vector<std::uint8_t> pixels(n * chartBytes);
+	nThreads = std::max(1u, std::min<unsigned int>(nThreads, n));
+	auto worker = [&](unsigned int k)
+	{
+		std::size_t const end = n * (k + 1) / nThreads;
+		for (std::size_t i = n * k / nThreads; i < end; ++i)
+			loadTexturePNG(&pixels[i * chartBytes], *textures[i], size, size);
+	};
+	std::vector<std::thread> threads;
+	for (unsigned int k = 1; k < nThreads; ++k)
+		threads.emplace_back(worker, k);
+	worker(0);
+	for (auto& t: threads)
+		t.join();
+
+	tm->getTextureBlock().loadTexture();
+	tm->getTextureBlock().loadCharts(0, n, pixels.data());
+	if (!cache.empty() && !atlasCache.write(key, textures, size, pixels.data()))
+		std::cerr << "Unable to write the atlas cache " << cache << '\n';
 
 	return tm;
 }
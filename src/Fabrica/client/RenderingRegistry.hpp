@@ -2,8 +2,12 @@
 #define FABRICA_CLIENT_RENDERINGREGISTRY_HPP_
 
 #include <cassert>
+#include <cstddef>
 #include <map>
 #include <mutex>
+#include <thread>
+
+#include <boost/filesystem/path.hpp>
 
 #include "../block/Block.hpp"
 #include "renderer/block/RenderBlock.hpp"
@@ -30,8 +34,25 @@ public:
 
 	/**
 	 * @brief Load each renderer's texture into the TextureManager.
+	 *
+	 * The textures are registered first, then decoded on nThreads threads
+	 * and loaded into the atlas at once on the calling thread, which must
+	 * hold the GL context. A texture used by several renderers takes one
+	 * chart.
+	 *
+	 * The chart size follows the largest texture, within the budget (see
+	 * {@code TextureManager::blockSizeFor}). Other textures are resampled to
+	 * it as they are decoded.
+	 *
+	 * @param[in] cache File of an {@code AtlasCache}. If it holds the same
+	 *  textures, they are loaded from it without decoding; otherwise it is
+	 *  rewritten. No cache is used if empty.
+	 * @param[in] budget Video memory for the block atlas, in bytes
 	 */
-	static TextureManager* initAll();
+	static TextureManager*
+	initAll(boost::filesystem::path const& cache = boost::filesystem::path(),
+	        std::size_t budget = TextureManager::defaultBudget,
+	        unsigned int nThreads = std::thread::hardware_concurrency());
 
 private:
 	RenderingRegistry() = delete;
@@ -7,6 +7,7 @@
 #include "WorldRenderer.hpp"
 #include "gui/GUIBase.hpp"
 #include "renderer/Text.hpp"
+#include "renderer/UIBatch.hpp"
 
 namespace fab
 {
@@ -100,6 +101,11 @@ void windowResizeCallback(GLFWwindow* window,
 	glViewport(0, 0, width, height);
 }
 
+void Window::swapBuffers()
+{
+	UIBatch::flush();
+	glfwSwapBuffers(window);
+}
 std::string Window::initAll(int width, int height)
 {
 	if (!instance().create(width, height))
@@ -113,7 +119,7 @@ std::string Window::initAll(int width, int height)
 	if (!Font::init())
 		return "class Window: Font initialisation failed";
 
-	Text::init();
+	UIBatch::init();
 	GUIBase::init();
 	WorldRenderer::init();
 
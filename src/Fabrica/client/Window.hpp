@@ -285,7 +285,7 @@ public:
 	 * 2. Make the window context current
 	 * 3. Initialises GLEW
 	 * 4. Font::init()
-	 * 5. Text::init()
+	 * 5. UIBatch::init()
 	 * 6. GUIBase::init()
 	 * 7. Binds the keys and size callbacks
 	 *
@@ -304,7 +304,10 @@ public:
 	bool create(int w, int h);
 
 	bool isOpen() const { return !glfwWindowShouldClose(window); }
-	void swapBuffers() { glfwSwapBuffers(window); }
+	/**
+	 * @brief Draws the pending {@code UIBatch} and swaps the buffers.
+	 */
+	void swapBuffers();
 	void pollEvents() { glfwPollEvents(); }
 	/**
 	 * Width of this window
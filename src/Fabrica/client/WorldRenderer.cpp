@@ -1,10 +1,11 @@
 #include "WorldRenderer.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include "RenderingRegistry.hpp"
 #include "renderer/utils.hpp"
-
 #include "../core/Fabrica.hpp"
 
 namespace fab
@@ -52,19 +53,24 @@ void WorldRenderer::init()
 	programPTransform = glGetUniformLocation(program, "transform");
 }
 WorldRenderer::WorldRenderer(Window* const window,
-                             WorldIn* const world,
-                             std::mutex* const mutexWorld,
+                             World* const world,
                              InteractionFlags* const interactions,
                              TextureManager* const textureManager):
 	WindowListener(window),
 	window(window),
 	world(world),
-	mutexWorld(mutexWorld),
 	interactions(interactions),
 	textureManager(textureManager),
+	origin(0, 0, 0),
 	radiusXZ(6), radiusY(6),
 	nChunks((2 * radiusXZ - 1) * (2 * radiusY - 1) * (2 * radiusXZ - 1)),
-	chunkLoadOrder(genChunkLoadOrder(radiusXZ, radiusY))
+	chunkLoadOrder(genChunkLoadOrder(radiusXZ, radiusY)),
+	residency(world->getResidencyStats()),
+	journal(world->getJournal().subscribe()),
+	streamNext(0),
+	meshStats(),
+	editPending(false), editDrawn(false),
+	reach(8.f)
 {
 	// Loads the chunkGeometries
 	chunkGeometries = new ChunkGeometry** [radiusXZ * 2 - 1];
@@ -81,6 +87,8 @@ WorldRenderer::WorldRenderer(Window* const window,
 			}
 		}
 	}
+	for (int i = 0; i < nChunks; ++i)
+		geometry(chunkLoadOrder[i]).order = i;
 }
 WorldRenderer::~WorldRenderer()
 {
@@ -99,6 +107,7 @@ WorldRenderer::~WorldRenderer()
 	}
 	delete[] chunkGeometries;
 	delete[] chunkLoadOrder;
+	world->getJournal().unsubscribe(journal);
 }
 
 void WorldRenderer::onKey(Key key, KeyAction ka, KeyMod)
@@ -127,9 +136,46 @@ void WorldRenderer::onKey(Key key, KeyAction ka, KeyMod)
 		}
 	}
 }
-void WorldRenderer::onMouse(MouseButton, bool press, KeyMod)
+void WorldRenderer::onMouse(MouseButton button, bool press, KeyMod)
 {
-	// Does nothing...
+	if (!press || !interactions->trapCursor ||
+	    button == MouseButton::Middle)
+		return;
+
+	Vector3f const origin(camera.getX(), camera.getY(), camera.getZ());
+	Vector3f const range(reach, reach, reach);
+	RayHit hit;
+	{
+		WorldLocks::Region guard(world->getLocks(),
+		                         World::chunkOf(origin - range),
+		                         World::chunkOf(origin + range),
+		                         WorldLocks::READ);
+		hit = world->raycast(Ray{origin, camera.getDirection(), reach});
+	}
+	if (!hit.hit) return;
+	Vector3i const target = button == MouseButton::Left || isEmpty(hit.face) ?
+	                        hit.position : hit.position + toFace(hit.face);
+	if (button == MouseButton::Right && target == hit.position) return;
+	bool changed;
+	{
+		Vector3i const chunk = World::chunkOf(target.cast<float>());
+		WorldLocks::Region guard(world->getLocks(),
+		                         chunk - Vector3i(1, 1, 1),
+		                         chunk + Vector3i(1, 1, 1),
+		                         WorldLocks::WRITE);
+		changed = world->setBlock(target, button == MouseButton::Left ?
+		                          &BlockNull::instance :
+		                          (Block*) &Fabrica::blockGrass);
+	}
+	{
+		WorldLocks::Exclusive guard(world->getLocks());
+		world->updateLight();
+	}
+	if (changed && !editPending)
+	{
+		editTime = std::chrono::steady_clock::now();
+		editPending = true;
+	}
 }
 void WorldRenderer::loadChunk(Vector3i const& offset,
                               Vector3i const& pRelative)
@@ -138,17 +184,27 @@ void WorldRenderer::loadChunk(Vector3i const& offset,
 	assert(-radiusY < pRelative.y() && pRelative.y() < radiusY);
 	assert(-radiusXZ < pRelative.z() && pRelative.z() < radiusXZ);
 
-	ChunkGeometry& cg = chunkGeometries[pRelative.x()][pRelative.y()][pRelative.z()];
+	ChunkGeometry& cg = geometry(pRelative);
 
 	Vector3i const pAbsolute = offset + pRelative;
 	Vector3i const pBase = Chunk::size * pAbsolute;
+	WorldLocks::Region guard(world->getLocks(),
+	                         pAbsolute - Vector3i(1, 1, 1),
+	                         pAbsolute + Vector3i(1, 1, 1),
+	                         WorldLocks::READ);
 	ChunkIn* chunk = world->getChunkO(pAbsolute);
 	if (!chunk)
 	{
+		// Never loaded, or evicted. Meshed again once it is loaded.
 		cg.draw = false;
-		return; // No Geometry update needed.
+		cg.meshed = false;
+		std::vector<RVertex>().swap(cg.vertices);
+		std::vector<unsigned int>().swap(cg.indices);
+		return;
 	}
 	cg.draw = true;
+	cg.meshed = true;
+	cg.upload = true;
 	cg.vertices.clear();
 	cg.indices.clear();
 
@@ -158,17 +214,72 @@ void WorldRenderer::loadChunk(Vector3i const& offset,
 		for (int y = 0; y < Chunk::size; ++y)
 			for (int z = 0; z < Chunk::size; ++z)
 			{
-				// Block* b = chunk->getBlock(x, y, z);
-				RenderBlock* rb = RenderingRegistry::getRenderer(&Fabrica::blockGrass);
+				Block* b = chunk->getBlock(x, y, z);
+				if (b == &BlockNull::instance) continue;
+				RenderBlock* rb = RenderingRegistry::getRenderer(b);
 				rb->loadGeometry(world, pBase + Vector3i(x,y,z),
 				                 textureManager->getTextureBlock(), gl);
 				gl.nextOffset();
 			}
+	// The buffers hold the previous mesh until it is uploaded.
+	meshBytes.emplace_back(pAbsolute, cg.bytes());
+}
+void WorldRenderer::remeshChanged()
+{
+	changes.clear();
+	if (!world->getJournal().drain(journal, changes))
+	{
+		// Changes were lost; rebuild everything.
+		for (int i = 0; i < nChunks; ++i)
+			dirty.markChunk(chunkLoadOrder[i]);
+	}
+	for (auto const& c: changes)
+	{
+		if (c.chunk)
+			dirty.markBlocks(c.position);
+		else
+			dirty.markBlock(c.position);
+	}
+	meshStats.nPriority = 0;
+	if (dirty.empty()) return;
+
+	for (auto const& p: dirty.take())
+	{
+		if (std::abs(p.x()) >= radiusXZ || std::abs(p.y()) >= radiusY ||
+		    std::abs(p.z()) >= radiusXZ)
+			continue;
+		ChunkGeometry& cg = geometry(p);
+		if (cg.meshed)
+		{
+			loadChunk(origin, p);
+			++meshStats.nPriority;
+		}
+		else // Possibly loaded since it was found missing
+			streamNext = std::min(streamNext, cg.order);
+	}
+}
+void WorldRenderer::meshStreaming()
+{
+	for (int n = 0; n < streamBudget && streamNext < nChunks; ++streamNext)
+	{
+		Vector3i const& p = chunkLoadOrder[streamNext];
+		if (geometry(p).meshed) continue;
+		loadChunk(origin, p);
+		++n;
+	}
+	meshStats.nStreaming = nChunks - streamNext;
+}
+void WorldRenderer::onPresent()
+{
+	if (!editDrawn) return;
+	meshStats.editLatency =
+	  std::chrono::duration<float, std::milli>(
+	    std::chrono::steady_clock::now() - editTime).count();
+	editPending = editDrawn = false;
 }
 void WorldRenderer::draw(Camera const& camera)
 {
-	// Read data from the world
-	mutexWorld->lock();
+	this->camera = camera;
 
 	interactions->moveFront = window->isKeyPressed(Key::W);
 	interactions->moveBack = window->isKeyPressed(Key::S);
@@ -177,8 +288,24 @@ void WorldRenderer::draw(Camera const& camera)
 	interactions->moveUp = window->isKeyPressed(Key::Space);
 	interactions->moveDown = window->isKeyPressed(Key::ShiftLeft);
 
-	loadChunk(Vector3i(0,0,0), Vector3i(0,0,0));
-	mutexWorld->unlock();
+	// Evicted before meshing, so that the meshes of the evicted chunks are
+	// dropped in this frame. The residency changes, including the mesh sizes
+	// of the last frame, need the exclusive lock.
+	{
+		WorldLocks::Exclusive guard(world->getLocks());
+		for (auto const& m: meshBytes)
+			world->setMeshBytes(m.first, m.second);
+		meshBytes.clear();
+		world->touchColumns(Vector2i(origin.x(), origin.z()), radiusXZ);
+		world->evict(Vector2i(origin.x(), origin.z()), radiusXZ);
+		residency = world->getResidencyStats();
+	}
+
+	// Edits are meshed in full before any streaming work, so that they are
+	// drawn in this frame.
+	remeshChanged();
+	editDrawn = editPending;
+	meshStreaming();
 
 	// Drawing
 
@@ -190,17 +317,22 @@ void WorldRenderer::draw(Camera const& camera)
 	glUseProgram(program);
 	glUniformMatrix4fv(programPTransform, 1, GL_FALSE, &matrix[0][0]);
 
-	ChunkGeometry& cg = chunkGeometries[0][0][0];
+	glEnableVertexAttribArray(0); // Position array
+	glEnableVertexAttribArray(1); // UV array
+	glEnableVertexAttribArray(2); // W array
+	meshStats.nMeshes = 0;
+	for (int i = 0; i < nChunks; ++i)
 	{
-		glEnableVertexAttribArray(0); // Position array
-		glEnableVertexAttribArray(1); // UV array
-		glEnableVertexAttribArray(2); // W array
+		ChunkGeometry& cg = geometry(chunkLoadOrder[i]);
+		if (!cg.draw) continue;
+		++meshStats.nMeshes;
 
 		glBindBuffer(GL_ARRAY_BUFFER, cg.bufferVert);
-		glBufferData(GL_ARRAY_BUFFER,
-		             cg.vertices.size() * sizeof(RVertex),
-		             cg.vertices.data(),
-		             GL_DYNAMIC_DRAW);
+		if (cg.upload)
+			glBufferData(GL_ARRAY_BUFFER,
+			             cg.vertices.size() * sizeof(RVertex),
+			             cg.vertices.data(),
+			             GL_DYNAMIC_DRAW);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
 		                      sizeof(RVertex), (void*) offsetof(RVertex, p));
 		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE,
@@ -208,16 +340,21 @@ void WorldRenderer::draw(Camera const& camera)
 		glVertexAttribPointer(2, 1, GL_UNSIGNED_INT, GL_FALSE,
 		                      sizeof(RVertex), (void*) offsetof(RVertex, w));
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cg.bufferInd);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-		             cg.indices.size() * sizeof(unsigned int),
-		             cg.indices.data(),
-		             GL_DYNAMIC_DRAW);
+		if (cg.upload)
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+			             cg.indices.size() * sizeof(unsigned int),
+			             cg.indices.data(),
+			             GL_DYNAMIC_DRAW);
+		if (cg.upload)
+		{
+			cg.uploaded = cg.vertices.size() * sizeof(RVertex) +
+			              cg.indices.size() * sizeof(unsigned int);
+			meshBytes.emplace_back(origin + chunkLoadOrder[i], cg.bytes());
+		}
+		cg.upload = false;
 
 		glDrawElements(GL_TRIANGLES, cg.indices.size(), GL_UNSIGNED_INT, nullptr);
 	}
-
-
 }
 
 } // namespace fab
-
@@ -1,7 +1,8 @@
 #ifndef FABRICA_CLIENT_WORLDRENDERER_HPP_
 #define FABRICA_CLIENT_WORLDRENDERER_HPP_
 
-#include <mutex>
+#include <chrono>
+#include <utility>
 #include <vector>
 
 #include "Camera.hpp"
@@ -9,6 +10,7 @@
 #include "renderer/Render.hpp"
 #include "renderer/TextureManager.hpp"
 #include "../util/facing.hpp"
+#include "../world/DirtyChunks.hpp"
 #include "../world/World.hpp"
 
 namespace fab
@@ -37,13 +39,29 @@ struct InteractionFlags
 
 struct ChunkGeometry
 {
-	ChunkGeometry(): draw(false) {}
+	ChunkGeometry():
+		uploaded(0), order(0), draw(false), meshed(false), upload(false) {}
+
+	/**
+	 * @brief Bytes allocated for the mesh, in memory and in the GL buffers.
+	 */
+	std::size_t bytes() const noexcept
+	{
+		return vertices.capacity() * sizeof(RVertex) +
+		       indices.capacity() * sizeof(unsigned int) + uploaded;
+	}
 
 	std::vector<RVertex> vertices;
 	std::vector<unsigned int> indices;
 	GLuint bufferVert;
 	GLuint bufferInd;
+	std::size_t uploaded; ///< Bytes last uploaded to the buffers
+	int order; ///< Index in the load order of the renderer
 	bool draw;
+	/// Built from a loaded chunk, so kept up to date with edits. Cleared when
+	/// the chunk is found missing, so that it is streamed again once loaded.
+	bool meshed;
+	bool upload; ///< Rebuilt since the buffers were last filled
 };
 
 class GeometryLoaderChunk final: public GeometryLoader
@@ -69,8 +87,27 @@ private:
 	unsigned int offset;
 };
 
+/**
+ * @brief Meshing counters of a {@code WorldRenderer}.
+ */
+struct MeshStats
+{
+	int nMeshes; ///< Chunks drawn
+	int nStreaming; ///< Chunks in range waiting for their first mesh
+	int nPriority; ///< Meshes rebuilt for block changes in the last frame
+	/// Milliseconds from the last player edit to the frame showing it
+	float editLatency;
+};
+
 /**
  * One instance of this class in Client handles drawing the in-game world.
+ *
+ * Meshes are built in two lanes. Chunks whose blocks changed are rebuilt
+ * first, all of them, in the frame after the change. Chunks in range that have
+ * no mesh yet are then built nearest first, at most {@code streamBudget} per
+ * frame. Chunks that are evicted stop being drawn, and those that are loaded
+ * (or loaded again) return to the streaming lane, both through the journal of
+ * the world.
  */
 class WorldRenderer final: public WindowListener
 {
@@ -78,32 +115,85 @@ public:
 	static void init();
 
 	WorldRenderer(Window* const,
-	              WorldIn* const,
-	              std::mutex* const,
+	              World* const,
 	              InteractionFlags* const,
 	              TextureManager* const);
 	~WorldRenderer();
 
 	virtual void onKey(Key, KeyAction, KeyMod) override;
+	/**
+	 * @brief Left click breaks the block under the crosshair, right click
+	 *  places a block against it.
+	 */
 	virtual void onMouse(MouseButton, bool press, KeyMod) override;
 
+	/**
+	 * @brief Rebuilds the mesh of a chunk. Takes a read lock on the chunk and
+	 *  its neighbours.
+	 */
 	void loadChunk(Vector3i const& offset, Vector3i const& pRelative);
 	/**
 	 * @brief Draws the 3D component of the world.
 	 */
 	void draw(Camera const& mCamera);
 
+	/**
+	 * @brief Called after the frame drawn by {@code draw} is presented, to
+	 *  measure the latency of edits.
+	 */
+	void onPresent();
+
+	MeshStats getMeshStats() const noexcept { return meshStats; }
+	/**
+	 * @brief Residency counters of the world, as of the last {@code draw}.
+	 */
+	ResidencyStats getResidencyStats() const noexcept { return residency; }
+
 private:
+	ChunkGeometry& geometry(Vector3i const& pRelative) noexcept
+	{
+		return chunkGeometries[pRelative.x() + radiusXZ - 1]
+		                      [pRelative.y() + radiusY - 1]
+		                      [pRelative.z() + radiusXZ - 1];
+	}
+	/**
+	 * @brief Rebuilds the meshes made stale by the block changes since the
+	 *  last call.
+	 */
+	void remeshChanged();
+	/**
+	 * @brief Builds the meshes of up to {@code streamBudget} chunks that have
+	 *  none.
+	 */
+	void meshStreaming();
+
 	Window* window;
-	WorldIn* world;
-	std::mutex* mutexWorld;
+	World* world;
 	InteractionFlags* interactions;
 	TextureManager* textureManager;
 
+	/// Chunk at the centre of the meshes, which residency is centred on too
+	Vector3i origin;
 	int radiusXZ, radiusY; ///< Radius for loading chunks
 	int nChunks;
 	Vector3i* chunkLoadOrder; ///< Order by which to load chunks
 	ChunkGeometry*** chunkGeometries;
+	ResidencyStats residency;
+	/// Mesh sizes to report to the world under its exclusive lock
+	std::vector<std::pair<Vector3i, std::size_t>> meshBytes;
+	int journal; ///< Subscription to the block changes of the world
+	std::vector<BlockChange> changes;
+	DirtyChunks dirty;
+	static constexpr int const streamBudget = 8; ///< Meshes per frame
+	/// Entry of chunkLoadOrder to mesh next. Earlier entries all have a mesh
+	/// or are missing from the world.
+	int streamNext;
+	MeshStats meshStats;
+	bool editPending; ///< A player edit is not presented yet
+	bool editDrawn; ///< The pending edit is in the frame being presented
+	std::chrono::steady_clock::time_point editTime;
+	Camera camera; ///< Camera of the last {@code draw}
+	float reach; ///< Distance up to which blocks can be edited
 
 	static GLuint program;
 	static GLuint programPTransform;
@@ -27,7 +27,7 @@ public:
 	static void init();
 //protected:
 	/**
-	 * @brief Fills a rectangle
+	 * @brief Fills a rectangle, in the {@code UIBatch}
 	 * @param[in] x0 Left bound
 	 * @param[in] y0 Up bound
 	 * @param[in] x1 Right bound
@@ -38,9 +38,6 @@ public:
 
 private:
 	static GLuint programPlanar; // Program for drawing textured 2d objects
-	static GLuint programFlat; // Program for drawing flat colors
-	static GLuint programFlatPColor; // Program uniform parameter: color
-	static GLuint buffer; // Buffer for drawing rects
 };
 
 } // namespace fab
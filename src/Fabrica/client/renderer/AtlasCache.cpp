@@ -0,0 +1,140 @@
+#include "AtlasCache.hpp"
+
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../common/ModuleLoader.hpp"
+#include "../../util/file.hpp"
+
+namespace fab
+{
+
+namespace
+{
+
+char const magicAtlas[4] = {'F', 'A', 'B', 'A'};
+std::uint32_t const versionAtlas = 1;
+std::size_t const alignment = 16; ///< Of the pixels
+
+} // namespace
+
+AtlasCache::AtlasCache(boost::filesystem::path file):
+	file(file), mapping(nullptr), mappingSize(0), pixels(nullptr)
+{
+}
+AtlasCache::~AtlasCache()
+{
+	close();
+}
+
+std::uint64_t
+AtlasCache::key(std::vector<ResourceLocation const*> const& textures,
+                int size)
+{
+	std::uint64_t h = fnvBasis;
+	for (auto const* rl: textures)
+	{
+		std::string const name = rl->string();
+		hashFNV(h, name.c_str(), name.size() + 1);
+
+		boost::system::error_code error;
+		std::int64_t time = boost::filesystem::last_write_time(
+		  ModuleLoader::instance().resolveLocation(*rl), error);
+		if (error) time = -1; // Missing textures are decoded as such
+		hashFNV(h, &time, sizeof(time));
+	}
+	hashFNV(h, &size, sizeof(size));
+	return h;
+}
+
+bool AtlasCache::open(std::uint64_t key,
+                      std::vector<ResourceLocation const*> const& textures,
+                      int size)
+{
+	close();
+	int fd = ::open(file.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat s;
+	if (::fstat(fd, &s) != 0 || (std::size_t) s.st_size < sizeof(Header))
+	{
+		::close(fd);
+		return false;
+	}
+	void* p = ::mmap(nullptr, s.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd); // The mapping keeps the file
+	if (p == MAP_FAILED) return false;
+	mapping = static_cast<char*>(p);
+	mappingSize = s.st_size;
+
+	Header h;
+	std::memcpy(&h, mapping, sizeof(Header));
+	std::size_t const bytes = (std::size_t) size * size * 4 * textures.size();
+	if (std::memcmp(h.magic, magicAtlas, 4) != 0 ||
+	    h.version != versionAtlas || h.key != key ||
+	    h.size != (std::uint32_t) size || h.nCharts != textures.size() ||
+	    h.pixels > mappingSize || mappingSize - h.pixels < bytes)
+	{
+		close();
+		return false;
+	}
+
+	// The key could collide, so the chart assignment is compared as well.
+	char const* name = mapping + sizeof(Header);
+	char const* const end = mapping + h.pixels;
+	for (auto const* rl: textures)
+	{
+		std::string const expected = rl->string();
+		if (end - name < (std::ptrdiff_t) expected.size() + 1 ||
+		    std::memcmp(name, expected.c_str(), expected.size() + 1) != 0)
+		{
+			close();
+			return false;
+		}
+		name += expected.size() + 1;
+	}
+
+	pixels = end;
+	return true;
+}
+bool AtlasCache::write(std::uint64_t key,
+                       std::vector<ResourceLocation const*> const& textures,
+                       int size, void const* pixels)
+{
+	std::string buffer(sizeof(Header), '\0');
+	for (auto const* rl: textures)
+	{
+		buffer += rl->string();
+		buffer += '\0';
+	}
+	buffer.resize((buffer.size() + alignment - 1) / alignment * alignment,
+	              '\0');
+
+	Header h;
+	std::memcpy(h.magic, magicAtlas, 4);
+	h.version = versionAtlas;
+	h.key = key;
+	h.size = size;
+	h.nCharts = textures.size();
+	h.pixels = buffer.size();
+	std::memcpy(&buffer[0], &h, sizeof(Header));
+
+	// Replaced whole, so that a crash never leaves half a cache
+	std::size_t const bytes = (std::size_t) size * size * 4 * textures.size();
+	return replaceFile(file, {{buffer.data(), buffer.size()}, {pixels, bytes}});
+}
+
+void AtlasCache::close() noexcept
+{
+	if (mapping)
+		::munmap(mapping, mappingSize);
+	mapping = nullptr;
+	mappingSize = 0;
+	pixels = nullptr;
+}
+
+} // namespace fab
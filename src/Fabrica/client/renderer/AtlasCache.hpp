@@ -0,0 +1,88 @@
+#ifndef FABRICA_CLIENT_RENDERER_ATLASCACHE_HPP_
+#define FABRICA_CLIENT_RENDERER_ATLASCACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+
+#include "../../util/ResourceLocation.hpp"
+
+namespace fab
+{
+
+/**
+ * @brief A file storing the decoded charts of a texture atlas, so that an
+ *  unchanged set of textures loads without decoding any PNG.
+ *
+ * Layout:
+ *
+ * 	[Header][Locations][Pixels]
+ *
+ * The header holds the key of the textures, which hashes their locations and
+ * the modification times of their files. The locations follow in chart order,
+ * each terminated by a null character, and record the chart assignment. The
+ * pixels of the charts follow at an offset aligned to 16 bytes, chart after
+ * chart, as {@code TextureAtlas::loadCharts} takes them.
+ *
+ * The file is memory-mapped for reads and replaced by a rename on writes.
+ * Uses POSIX file I/O.
+ */
+class AtlasCache final: boost::noncopyable
+{
+public:
+	AtlasCache(boost::filesystem::path file);
+	~AtlasCache();
+
+	/**
+	 * @brief Hashes the locations of the textures, the modification times of
+	 *  their files and the chart size.
+	 */
+	static std::uint64_t
+	key(std::vector<ResourceLocation const*> const& textures, int size);
+
+	/**
+	 * @brief Maps the file.
+	 * @return True if the file holds the given textures, in the same order,
+	 *  under the given key.
+	 */
+	bool open(std::uint64_t key,
+	          std::vector<ResourceLocation const*> const& textures,
+	          int size);
+	/**
+	 * @brief Pixels of the charts. Valid after a successful {@code open}.
+	 */
+	void const* getPixels() const noexcept { return pixels; }
+
+	/**
+	 * @brief Replaces the file with the given textures and their pixels.
+	 */
+	bool write(std::uint64_t key,
+	           std::vector<ResourceLocation const*> const& textures,
+	           int size, void const* pixels);
+
+private:
+	struct Header
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint64_t key;
+		std::uint32_t size; ///< Width and height of a chart
+		std::uint32_t nCharts;
+		std::uint64_t pixels; ///< Offset of the pixels
+	};
+
+	void close() noexcept;
+
+	boost::filesystem::path file;
+
+	char* mapping;
+	std::size_t mappingSize;
+	void const* pixels;
+};
+
+} // namespace fab
+
+#endif // !FABRICA_CLIENT_RENDERER_ATLASCACHE_HPP_
@@ -1,8 +1,10 @@
 #include "Font.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
 
+#include "UIBatch.hpp"
 #include "utils.hpp"
 #include "../../util/ResourceLocation.hpp"
 #include "../../common/ModuleLoader.hpp"
@@ -12,6 +14,9 @@ namespace fab
 
 int const defaultFontSize = 20;
 
+constexpr unsigned int const Font::sdfSize;
+constexpr int const Font::sdfSpread;
+
 FT_Library Font::ft;
 Font Font::defaultF;
 
@@ -31,6 +36,7 @@ bool Font::init()
 		assert(false && "class Font: Failed to load default Font");
 		return false;
 	}
+	defaultF.setSDF(true);
 	defaultF.setFontSize(20);
 
 	return true;
@@ -38,9 +44,15 @@ bool Font::init()
 
 Font::Font():
 	size(0),
+	sdf(false),
+	sdfNext(false),
+	rasterised(0),
 	width(0),
 	height(0),
-	texture(0)
+	texture(0),
+	nPlanes(0),
+	nCells(0),
+	generation(0)
 {
 	// Must not call any GL function here
 	// The default font is being initialised.
@@ -58,106 +70,196 @@ bool Font::setFontFile(char const fileName[])
 }
 bool Font::setFontSize(unsigned int size)
 {
-	glDeleteTextures(1, &texture);
-	glGenTextures(1, &texture);
-
-	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
-
 	assert(size != 0);
 	this->size = size;
+	++generation; // The metrics change even if the glyphs are kept
+	unsigned int const pixels = sdfNext ? sdfSize : size;
+	if (rasterised == pixels && sdf == sdfNext)
+		return true;
+	sdf = sdfNext;
 
 	// FT_Select_Charmap(face, FT_ENCODING_UNICODE);
-	FT_Set_Pixel_Sizes(face, 0, size);
+	FT_Set_Pixel_Sizes(face, 0, pixels);
 
-	// First loop: Calculate maxW and maxH
-	chartW = 0;
-	chartH = 0;
-	for (int i = 0; i < FONT_NUMBER_GLYPHS ; ++i)
+	// The bounding box of all glyphs, instead of rasterising each of them
+	auto const& metrics = face->size->metrics;
+	chartW = (FT_MulFix(face->bbox.xMax - face->bbox.xMin, metrics.x_scale)
+	          + 63) / 64;
+	chartH = (FT_MulFix(face->bbox.yMax - face->bbox.yMin, metrics.y_scale)
+	          + 63) / 64;
+	if (chartW <= 0 || chartH <= 0)
 	{
-		if (FT_Load_Char(face, i, FT_LOAD_RENDER))
-			continue;
-		chartW = std::max<int>(chartW, face->glyph->bitmap.width);
-		chartH = std::max<int>(chartH, face->glyph->bitmap.rows);
+		// Bitmap fonts have no bounding box.
+		chartW = (metrics.max_advance + 63) / 64;
+		chartH = (metrics.height + 63) / 64;
 	}
-	if (chartW == 0 || chartH == 0)
+	if (chartW <= 0 || chartH <= 0)
 	{
 		std::cerr << "No Valid Glyph found\n";
 		return false;
 	}
-
-	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	if (sdf)
+	{
+		chartW += 2 * sdfSpread;
+		chartH += 2 * sdfSpread;
+	}
 	width = chartW * FONT_PLANE_WIDTH;
 	height = chartH * FONT_PLANE_WIDTH;
 
-	// 8bit/pixel, so alignment = 1
-	glTextureStorage3D(texture,
+	glyphs.clear();
+	lru.clear();
+	nCells = 0;
+	glDeleteTextures(1, &texture);
+	texture = 0;
+	nPlanes = 0;
+	grow(1);
+
+	rasterised = pixels;
+	for (int c = 0x20; c < 0x7F; ++c) // Printable ASCII
+		glyph(c);
+	GL_ERROR_CHECK;
+
+	return true;
+}
+
+Font::Glyph const& Font::rasterise(int c) const
+{
+	Glyph g;
+	g.cell = -1;
+	auto* const cd = &g.data;
+	if (FT_Load_Char(face, c, FT_LOAD_RENDER))
+	{
+		// Loading failed
+		*cd = CharData{0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+		return glyphs.emplace(c, g).first->second;
+	}
+
+	FT_Bitmap const& bitmap = face->glyph->bitmap;
+	// Glyphs are clipped to their cell, which the bounding box should avoid.
+	int sx = std::min<int>(bitmap.width, chartW);
+	int sy = std::min<int>(bitmap.rows, chartH);
+	std::vector<std::uint8_t> field;
+	if (sdf && sx > 0 && sy > 0)
+		field = distanceField(bitmap, &sx, &sy);
+
+	// The advance.[x,y] in Freetype are given in 1/64 pixels.
+	cd->ax = face->glyph->advance.x / 64.f;
+	cd->ay = face->glyph->advance.y / 64.f;
+	cd->sx = sx;
+	cd->sy = sy;
+	cd->mx = face->glyph->bitmap_left - (sdf ? sdfSpread : 0);
+	cd->my = face->glyph->bitmap_top + (sdf ? sdfSpread : 0);
+
+	if (sx > 0 && sy > 0)
+	{
+		g.cell = allocateCell();
+		int const plane = g.cell / FONT_PLANE_SIZE;
+		int const planeId = g.cell % FONT_PLANE_SIZE;
+
+		// 8bit/pixel, so alignment = 1
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, sdf ? 0 : bitmap.pitch);
+		glTextureSubImage3D(texture, // Texture
+		                    0, // Mipmap level
+		                    (planeId % FONT_PLANE_WIDTH) * chartW, // Offset X
+		                    (planeId / FONT_PLANE_WIDTH) * chartH, // Offset Y
+		                    plane,      // Offset Z
+		                    sx, // Size X
+		                    sy, // Size Y
+		                    1,  // Size Z
+		                    GL_RED,                    // Type
+		                    GL_UNSIGNED_BYTE,          // Len.
+		                    sdf ? field.data() : bitmap.buffer // Pixels
+		                   );
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		lru.push_front(c);
+		g.use = lru.begin();
+	}
+	return glyphs.emplace(c, g).first->second;
+}
+std::vector<std::uint8_t> Font::distanceField(FT_Bitmap const& bitmap,
+                                              int* const sx,
+                                              int* const sy) const
+{
+	int const w = bitmap.width, h = bitmap.rows;
+	auto inside = [&bitmap, w, h](int x, int y)
+	{
+		return 0 <= x && x < w && 0 <= y && y < h &&
+		       bitmap.buffer[y * bitmap.pitch + x] >= 128;
+	};
+
+	// Distance from each pixel to the nearest pixel on the other side of the
+	// outline, searched within the spread.
+	*sx = std::min(w + 2 * sdfSpread, chartW);
+	*sy = std::min(h + 2 * sdfSpread, chartH);
+	std::vector<std::uint8_t> field(*sx * *sy);
+	int const r2Max = (sdfSpread + 1) * (sdfSpread + 1);
+	for (int y = 0; y < *sy; ++y)
+		for (int x = 0; x < *sx; ++x)
+		{
+			int const bx = x - sdfSpread, by = y - sdfSpread;
+			bool const in = inside(bx, by);
+			int r2 = r2Max;
+			for (int dy = -sdfSpread; dy <= sdfSpread; ++dy)
+				for (int dx = -sdfSpread; dx <= sdfSpread; ++dx)
+					if (dx * dx + dy * dy < r2 && inside(bx + dx, by + dy) != in)
+						r2 = dx * dx + dy * dy;
+			// The outline lies half way between the two pixels.
+			float const d = (std::sqrt((float) r2) - 0.5f) * (in ? 1 : -1);
+			float const v = 0.5f + 0.5f * d / sdfSpread;
+			field[y * *sx + x] = std::min(std::max(v, 0.f), 1.f) * 255.f + 0.5f;
+		}
+	return field;
+}
+int Font::allocateCell() const
+{
+	if (nCells == nPlanes * FONT_PLANE_SIZE && nPlanes < FONT_MAX_PLANES)
+		grow(std::min(2 * nPlanes, FONT_MAX_PLANES));
+	if (nCells < nPlanes * FONT_PLANE_SIZE)
+		return nCells++;
+
+	// Full: the least recently used glyph is rasterised again if needed.
+	// Quads already batched still sample the old glyph from its cell.
+	UIBatch::flush();
+	auto const victim = glyphs.find(lru.back());
+	int const cell = victim->second.cell;
+	glyphs.erase(victim);
+	lru.pop_back();
+	++generation;
+	return cell;
+}
+void Font::grow(int newPlanes) const
+{
+	GLuint grown;
+	glGenTextures(1, &grown);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, grown);
+	glTextureStorage3D(grown,
 	                   1,
 	                   GL_R8, // Single channel format
 	                   width,
 	                   height,
-	                   FONT_NUMBER_PLANES
+	                   newPlanes
 	                  );
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	// Distance fields are interpolated.
+	GLint const filter = sdf ? GL_LINEAR : GL_NEAREST;
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, filter);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-	GL_ERROR_CHECK;
-
-	// Load Glyphs
-
-	for (int plane = 0; plane < FONT_NUMBER_PLANES; ++plane)
+	if (texture)
 	{
-		for (int i = 0; i < FONT_PLANE_WIDTH; ++i) // Row
-		{
-			for (int j = 0; j < FONT_PLANE_WIDTH; ++j) // Column
-			{
-				// Char id = rowShift + j
-
-				int id = plane * FONT_PLANE_SIZE
-				         + i * FONT_PLANE_WIDTH
-				         + j;
-				auto* cd = &charData[id];
-				if (FT_Load_Char(face, id, FT_LOAD_RENDER))
-				{
-					// Loading failed
-					cd->ax = 0.f;
-					cd->ay = 0.f;
-					cd->sx = 0.f;
-					cd->sy = 0.f;
-					cd->mx = 0.f;
-					cd->my = 0.f;
-				}
-				else
-				{
-					glTextureSubImage3D(texture, // Texture
-					                    0, // Mipmap level
-					                    j * chartW, // Offset X
-					                    i * chartH, // Offset Y
-					                    plane,      // Offset Z
-					                    face->glyph->bitmap.width, // Size X
-					                    face->glyph->bitmap.rows,  // Size Y
-					                    1,                         // Size Z
-					                    GL_RED,                    // Type
-					                    GL_UNSIGNED_BYTE,          // Len.
-					                    face->glyph->bitmap.buffer // Pixels
-					                   );
-
-					// The advance.[x,y] in Freetype are given in 1/64 pixels.
-					cd->ax = face->glyph->advance.x / 64.f;
-					cd->ay = face->glyph->advance.y / 64.f;
-					cd->sx = face->glyph->bitmap.width;
-					cd->sy = face->glyph->bitmap.rows;
-					cd->mx = face->glyph->bitmap_left;
-					cd->my = face->glyph->bitmap_top;
-				}
-			}
-		}
+		// Quads still pending in the batch sample the old texture.
+		UIBatch::flush();
+		glCopyImageSubData(texture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+		                   grown, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+		                   width, height, nPlanes);
+		glDeleteTextures(1, &texture);
 	}
-	GL_ERROR_CHECK;
+	texture = grown;
+	nPlanes = newPlanes;
 
-	return true;
+	GL_ERROR_CHECK;
 }
 
 } // namespace fab
@@ -1,7 +1,12 @@
 #ifndef FABRICA_CLIENT_RENDERER_FONT_HPP_
 #define FABRICA_CLIENT_RENDERER_FONT_HPP_
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
 
 #include <GL/glew.h>
 #include <ft2build.h>
@@ -10,10 +15,9 @@
 namespace fab
 {
 
-#define FONT_NUMBER_GLYPHS 65536 // Must = planeWidth^2 * nPlanes
-#define FONT_NUMBER_PLANES 256
 #define FONT_PLANE_WIDTH 16
 #define FONT_PLANE_SIZE 256 // Must = planeWidth^2
+#define FONT_MAX_PLANES 16
 
 /**
  * @brief Provides an interface to FreeType for drawing texts on screen.
@@ -21,11 +25,26 @@ namespace fab
  *
  * Unicode is not supported yet.
  *
+ * Glyphs are rasterised on first use into the cells of an array texture,
+ * which grows by planes up to FONT_MAX_PLANES. Once it is full, the least
+ * recently used glyph gives its cell to the new one and the generation of
+ * the font changes, telling {@code Text} to lay itself out again. Only the
+ * ASCII range is rasterised in advance.
+ *
+ * In signed distance field mode, the glyphs are rasterised once at sdfSize
+ * pixels and the texture stores the distance to their outline, which
+ * {@code Text} renders crisply at any size. Changing the font size then only
+ * scales the metrics.
+ *
  * {@code Font} is the only interface in Fabrica to FreeType.
  */
 class Font final
 {
 public:
+	static constexpr unsigned int const sdfSize = 32; ///< In pixels
+	/// Distance in pixels at sdfSize at which the field saturates
+	static constexpr int const sdfSpread = 4;
+
 	/**
 	 * @brief Initialise the FreeType library and text shaders.
 	 * @return True if successful.
@@ -49,36 +68,61 @@ public:
 	 */
 	bool setFontFile(char const fileName[]);
 	/**
-	 * @brief Sets the font size and loads all glyphs.
-	 * @warning Must be called after {@code setFontFile}. This function has a
-	 *  high overhead.
+	 * @brief Sets the font size, empties the glyph cache and loads the ASCII
+	 *  glyphs. In signed distance field mode, the glyphs are kept if they
+	 *  are already rasterised.
+	 * @warning Must be called after {@code setFontFile}.
 	 *
 	 * @return True if successful.
 	 */
 	bool setFontSize(unsigned int size);
+	/**
+	 * @brief Switches the signed distance field mode, which takes effect on
+	 *  the next {@code setFontSize}.
+	 */
+	void setSDF(bool sdf) noexcept;
+	/**
+	 * @brief Mode of the current glyphs, which {@code setSDF} does not change
+	 *  until the next {@code setFontSize}.
+	 */
+	bool isSDF() const noexcept { return sdf; }
 
 	unsigned int getFontSize() const;
+	/**
+	 * @brief Number of glyphs with a cell in the texture.
+	 */
+	int getNCachedGlyphs() const noexcept { return lru.size(); }
+	/**
+	 * @brief Changes whenever a glyph loses its cell or the font size is set.
+	 *  Vertices laid out under another generation must be laid out again.
+	 */
+	std::uint64_t getGeneration() const noexcept { return generation; }
 
 	/**
 	 * @brief Loads via {@code glBindTexture} texture into memory.
 	 */
 	void loadTexture() const;
+	/**
+	 * @brief The texture of the glyphs, which changes when the cache grows.
+	 */
+	GLuint getTexture() const noexcept { return texture; }
 
 	/**
 	 * @brief Get the width of a given character.
 	 */
-	float getCharWidth(int c) const noexcept;
+	float getCharWidth(int c) const;
 	/**
 	 * @brief Get the height of a given character.
 	 */
-	float getCharHeight(int c) const noexcept;
+	float getCharHeight(int c) const;
 	/*
 	 * @brief Get the advance X of a given character
 	 */
-	float getCharAdvX(int c) const noexcept;
+	float getCharAdvX(int c) const;
 
 	/**
-	 * @brief Obtain the character information for a given char.
+	 * @brief Obtain the character information for a given char, rasterising
+	 *  it on first use.
 	 * @param[out] w The w coordinate of the character
 	 * @param[out] u0 Left u coordinate
 	 * @param[out] u1 Right u coordinate
@@ -99,7 +143,7 @@ public:
 	             float* const ax, float* const ay,
 	             float* const sx, float* const sy,
 	             float* const mx, float* const my,
-	             int c) const noexcept;
+	             int c) const;
 private:
 	static FT_Library ft;
 	static Font defaultF;
@@ -112,8 +156,49 @@ private:
 		float ax, ay; // Advance X, Advance Y
 		float sx, sy; // Size X, Size Y
 		float mx, my; // Min X, Min Y (bitmap_left, bitmap_top)
-	} charData[FONT_NUMBER_GLYPHS];
+	};
+	struct Glyph
+	{
+		CharData data;
+		int cell; ///< In the texture, or -1 if the glyph has no bitmap
+		std::list<int>::iterator use; ///< In lru, if the glyph has a cell
+	};
+
+	/**
+	 * @brief Finds the glyph of c, rasterising it if it is not cached, and
+	 *  marks it as used. The reference is invalidated by the next call.
+	 */
+	Glyph const& glyph(int c) const;
+	Glyph const& rasterise(int c) const;
+	/**
+	 * @brief Pixels of the bitmap converted to a distance field with a
+	 *  border of sdfSpread, clipped to a cell.
+	 */
+	std::vector<std::uint8_t> distanceField(FT_Bitmap const& bitmap,
+	                                        int* const sx,
+	                                        int* const sy) const;
+	/**
+	 * @brief Ratio of the font size to the size of the rasterised glyphs.
+	 */
+	float scale() const noexcept
+	{
+		return sdf ? (float) size / sdfSize : 1.f;
+	}
+	/**
+	 * @brief Takes a free cell, growing the texture or evicting the least
+	 *  recently used glyph if there is none.
+	 */
+	int allocateCell() const;
+	/**
+	 * @brief Replaces the texture with one of nPlanes planes, keeping the
+	 *  glyphs loaded.
+	 */
+	void grow(int nPlanes) const;
+
 	unsigned int size;
+	bool sdf; ///< Mode of the cached glyphs
+	bool sdfNext; ///< Mode set by {@code setSDF}
+	unsigned int rasterised; ///< Pixel size of the cached glyphs, 0 if none
 	/*
 	 * Maximal size of a glyph
 	 */
@@ -126,7 +211,14 @@ private:
 	int width, height;
 
 	FT_Face face;
-	GLuint texture;
+	mutable GLuint texture;
+	mutable int nPlanes;
+	mutable int nCells; ///< Cells ever taken, the free ones follow
+
+	mutable std::unordered_map<int, Glyph> glyphs;
+	/// Code points of the glyphs with a cell, most recently used first
+	mutable std::list<int> lru;
+	mutable std::uint64_t generation;
 };
 
 // Implementations
@@ -135,27 +227,25 @@ inline unsigned int Font::getFontSize() const
 {
 	return size;
 }
+inline void Font::setSDF(bool sdf) noexcept
+{
+	sdfNext = sdf;
+}
 inline void Font::loadTexture() const
 {
 	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
 }
-inline float Font::getCharWidth(int c) const noexcept
+inline float Font::getCharWidth(int c) const
 {
-	assert(0 <= c && c < FONT_NUMBER_GLYPHS &&
-	       "Character Id exceeded limits");
-	return charData[c].sx;
+	return glyph(c).data.sx * scale();
 }
-inline float Font::getCharHeight(int c) const noexcept
+inline float Font::getCharHeight(int c) const
 {
-	assert(0 <= c && c < FONT_NUMBER_GLYPHS &&
-	       "Character Id exceeded limits");
-	return charData[c].sy;
+	return glyph(c).data.sy * scale();
 }
-inline float Font::getCharAdvX(int c) const noexcept
+inline float Font::getCharAdvX(int c) const
 {
-	assert(0 <= c && c < FONT_NUMBER_GLYPHS &&
-	       "Character Id exceeded limits");
-	return charData[c].ax;
+	return glyph(c).data.ax * scale();
 }
 inline bool Font::getChar(GLuint* const w,
                           float* const u0, float* const u1,
@@ -163,15 +253,14 @@ inline bool Font::getChar(GLuint* const w,
                           float* const ax, float* const ay,
                           float* const sx, float* const sy,
                           float* const mx, float* const my,
-                          int c) const noexcept
+                          int c) const
 {
-	assert(0 <= c && c < FONT_NUMBER_GLYPHS &&
-	       "Character Id exceeded limits");
-
-	auto const* const cd = &charData[c];
+	Glyph const& g = glyph(c);
+	auto const* const cd = &g.data;
 
-	*w = c / FONT_PLANE_SIZE;
-	int planeId = c % FONT_PLANE_SIZE;
+	int const cell = std::max(g.cell, 0);
+	*w = cell / FONT_PLANE_SIZE;
+	int planeId = cell % FONT_PLANE_SIZE;
 
 	int x = planeId % FONT_PLANE_WIDTH;
 	int y = planeId / FONT_PLANE_WIDTH;
@@ -182,15 +271,26 @@ inline bool Font::getChar(GLuint* const w,
 	*v0 = (y * chartH) * invHeight;
 	*u1 = *u0 + cd->sx * invWidth;
 	*v1 = *v0 + cd->sy * invHeight;
-	*ax = cd->ax;
-	*ay = cd->ay;
-	*sx = cd->sx;
-	*sy = cd->sy;
-	*mx = cd->mx;
-	*my = cd->my;
+	float const k = scale();
+	*ax = cd->ax * k;
+	*ay = cd->ay * k;
+	*sx = cd->sx * k;
+	*sy = cd->sy * k;
+	*mx = cd->mx * k;
+	*my = cd->my * k;
 
 	return *ax != 0.f;
 }
+inline Font::Glyph const& Font::glyph(int c) const
+{
+	assert(0 <= c && "Character Id exceeded limits");
+	auto it = glyphs.find(c);
+	if (it == glyphs.end())
+		return rasterise(c);
+	if (it->second.cell >= 0)
+		lru.splice(lru.begin(), lru, it->second.use);
+	return it->second;
+}
 
 } // namespace fab
 
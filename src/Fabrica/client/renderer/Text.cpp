@@ -1,341 +1,253 @@
 #include "Text.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
-#include <boost/algorithm/string.hpp>
-
 #include "../Window.hpp"
 #include "../renderer/utils.hpp"
 
 namespace fab
 {
 
-GLuint Text::program;
-GLuint Text::programPColor;
-GLuint Text::buffer;
+namespace
+{
 
-void Text::init()
+/**
+ * Converts a colour to 0xAABBGGRR.
+ */
+std::uint32_t pack(float const color[]) noexcept
 {
-	char const sourceVert[] =
-	  "#version 330 core\n"
-	  "layout(location = 0) in vec2 vertPosition;"
-	  "layout(location = 1) in vec2 vertexUV;"
-	  "layout(location = 2) in uint tIdIn;"
-	  "out vec2 uv;"
-	  "flat out uint tId;"
-	  "void main()"
-	  "{"
-	  "gl_Position = vec4(vertPosition, 0, 1);"
-	  "uv = vertexUV;"
-	  "tId = tIdIn;"
-	  "}";
-	char const sourceFrag[] =
-	  "#version 330 core\n"
-	  "in vec2 uv;"
-	  "flat in uint tId;"
-	  "out vec4 color;"
-	  "uniform sampler2DArray sampler;"
-	  "uniform vec4 textColor;"
-	  "void main()"
-	  "{"
-	  "color = vec4(1,1,1,texture(sampler, vec3(uv, tId)).r) *"
-	  "        textColor;"
-	  "}";
-	bool flag = registerGLProgram(&program, sourceVert, sourceFrag);
-	assert(flag && "class Text: GL Program register failed");
-	(void) flag;
-	programPColor = glGetUniformLocation(program, "textColor");
+	std::uint32_t result = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		float const c = std::min(std::max(color[i], 0.f), 1.f);
+		result |= (std::uint32_t) (c * 255.f + 0.5f) << (8 * i);
+	}
+	return result;
 }
 
+} // namespace
+
 Text::Text() noexcept:
 		font(nullptr),
+		align(BOT_LEFT),
+		size(0),
+		x(0.f), y(0.f), ratioW(0.f), ratioH(0.f),
+		fontSize(0), back('\0'), generation(0),
 		hasGeometry(false)
 {
-	glGenBuffers(1, &bufferVert);
-	glGenBuffers(1, &bufferUV);
-	glGenBuffers(1, &bufferLayers);
-	glGenBuffers(1, &bufferIndices);
 }
 Text::Text(Font const* const font) noexcept:
 		font(font),
 		align(BOT_LEFT),
+		size(0),
+		x(0.f), y(0.f), ratioW(0.f), ratioH(0.f),
+		fontSize(0), back('\0'), generation(0),
 		hasGeometry(false)
 {
-	glGenBuffers(1, &bufferVert);
-	glGenBuffers(1, &bufferUV);
-	glGenBuffers(1, &bufferLayers);
-	glGenBuffers(1, &bufferIndices);
-}
-Text::~Text()
-{
-	glDeleteBuffers(1, &bufferVert);
-	glDeleteBuffers(1, &bufferUV);
-	glDeleteBuffers(1, &bufferLayers);
-	glDeleteBuffers(1, &bufferIndices);
 }
 
-void Text::draw() const
+void Text::draw()
 {
 	static float colorWhite[] = {1.f, 1.f, 1.f, 1.f};
 	draw(colorWhite);
 }
-void Text::draw(float color[]) const
+void Text::draw(float color[])
 {
 	if (!hasGeometry) return;
 	assert(font);
 
-	glUseProgram(program);
-	glUniform4f(programPColor,
-	            color[0],
-	            color[1],
-	            color[2],
-	            color[3]);
-
-	glActiveTexture(GL_TEXTURE0);
-	font->loadTexture();
-
-	glEnableVertexAttribArray(0); // Position array
-	glEnableVertexAttribArray(1); // UV array
-	glEnableVertexAttribArray(2); // Texture id array
-
-	glBindBuffer(GL_ARRAY_BUFFER, bufferVert);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-	glBindBuffer(GL_ARRAY_BUFFER, bufferUV);
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-	glBindBuffer(GL_ARRAY_BUFFER, bufferLayers);
-	glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, 0, nullptr);
+	if (generation != font->getGeneration())
+	{
+		// Some glyphs may have moved: the same text is laid out again.
+		String str;
+		for (std::size_t i = 0; i < lines.size(); ++i)
+		{
+			if (i) str += '\n';
+			str += lines[i].text;
+		}
+		setContents(x, y, align, str);
+	}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferIndices);
-	glDrawElements(GL_TRIANGLES, nIndices, GL_UNSIGNED_INT, nullptr);
+	UIBatch::addQuads(font->getTexture(), font->isSDF(),
+	                  vertices.data(), vertices.size(), pack(color));
+}
 
-	glDisableVertexAttribArray(0);
-	glDisableVertexAttribArray(1);
-	glDisableVertexAttribArray(2);
+void Text::setContents(float x, float y, Align align,
+                       String const& str)
+{
+	assert(font);
+	layOut(x, y, align, str);
+	// Laying out can evict the glyphs of the lines laid out before.
+	if (generation != font->getGeneration())
+		layOut(x, y, align, str);
 }
 
-void Text::setContents(float x, float y, Align align, String str) noexcept
+void Text::layOut(float x, float y, Align align, String const& str)
 {
-	if (str.empty())
+	// Glyph metrics are in pixels of the font size.
+	unsigned int const fontSize = font->getFontSize();
+	float const scale = size ? (float) size / fontSize : 1.f;
+	float const ratioW = Window::instance().getRatioW() * scale;
+	float const ratioH = Window::instance().getRatioH() * scale;
+	char const back = str.empty() ? '\0' : str.back();
+	std::size_t const nLines =
+	  str.empty() ? 0 : std::count(str.begin(), str.end(), '\n') + 1;
+	bool const bottom = align == BOT_LEFT || align == BOT_RIGHT;
+	bool const right = align == BOT_RIGHT || align == TOP_RIGHT;
+
+	// Lines are kept only if they stay in place.
+	if (x != this->x || y != this->y || align != this->align ||
+	    ratioW != this->ratioW || ratioH != this->ratioH ||
+	    fontSize != this->fontSize ||
+	    font->getGeneration() != generation ||
+	    (right && back != this->back) ||
+	    (bottom && nLines != lines.size()))
 	{
-		hasGeometry = false;
-		return; // No geometry needed
+		lines.clear();
+		vertices.clear();
+		this->x = x;
+		this->y = y;
+		this->align = align;
+		this->ratioW = ratioW;
+		this->ratioH = ratioH;
+		this->fontSize = fontSize;
+		this->back = back;
+		generation = font->getGeneration();
 	}
-	// Initial Character X and Y
-	float charX = x;
-	float charY = y;
-	float ratioW = Window::instance().getRatioW();
-	float ratioH = Window::instance().getRatioH();
 
 	// charX and charY should always be located at the bottom-left of
-	// each character.
-	// Right alignment requires shifting the X coordinate
-	// Top aligment requires shifting the Y coordinate
-	if (align == TOP_LEFT || align == TOP_RIGHT)
-	{
-		/*
-		float height = font->getCharHeight(align == TOP_RIGHT ?
-		                                   str.back() :
-		                                   str.front());
-		charY -= height * ratioH;
-		*/
-		charY -= font->getFontSize() * ratioH;
-	}
-
-	// Split string into lines
-	std::vector<String> lines;
-	boost::split(lines, str, boost::is_any_of("\n"));
-
-	// Calculate number of chars
-	int nChar = 0;
-	for (auto const& l : lines)
+	// each character. Lines are stored from the top.
+	float const lineH = fontSize * ratioH;
+	std::size_t begin = 0;
+	for (std::size_t i = 0; i < nLines; ++i)
 	{
-		nChar += l.size();
-	}
-	if (nChar == 0)
-	{
-		hasGeometry = false;
-		return;
-	}
+		std::size_t end = str.find('\n', begin);
+		if (end == String::npos) end = str.size();
+		std::size_t const length = end - begin;
+		float const charY = bottom ? y + (nLines - 1 - i) * lineH
+		                           : y - (i + 1) * lineH;
 
-	std::vector<Vector2f> vertices;
-	std::vector<Vector2f> uv;
-	std::vector<GLuint> layers;
-	vertices.reserve(nChar * 4);
-	uv.reserve(nChar * 4);
-	layers.reserve(nChar * 4);
-
-	switch (align)
-	{
-	case TOP_LEFT:
-	case TOP_RIGHT:
-		for (auto const& l: lines)
+		if (i == lines.size())
 		{
-			if (align == TOP_RIGHT)
-			{
-				charX = x - font->getCharAdvX(str.back()) * ratioW;
-			}
-			hasGeometry = loadLine(&vertices, &uv, &layers,
-			                       charX, charY, align,
-			                       l, ratioW, ratioH) ||
-			              hasGeometry;
-			charY -= font->getFontSize() * ratioH;
+			lines.emplace_back();
+			Line& line = lines.back();
+			line.text.assign(str, begin, length);
+			line.first = vertices.size();
+			line.nVertices = 0;
+			layLine(line, 0, charY);
+			replaceVertices(i, 0);
 		}
-		break;
-	case BOT_LEFT:
-	case BOT_RIGHT:
-		std::reverse(lines.begin(), lines.end());
-		for (auto const& l: lines)
+		else if (lines[i].text.compare(0, String::npos, str, begin, length))
 		{
-			if (align == BOT_RIGHT)
+			Line& line = lines[i];
+			std::size_t k = 0;
+			if (!right)
 			{
-				charX = x - font->getCharAdvX(str.back()) * ratioW;
+				std::size_t const common = std::min(length, line.text.size());
+				while (k < common && line.text[k] == str[begin + k])
+					++k;
 			}
-			hasGeometry = loadLine(&vertices, &uv, &layers,
-			                       charX, charY, align,
-			                       l, ratioW, ratioH) ||
-			              hasGeometry;
-			charY += font->getFontSize() * ratioH;
+			line.text.assign(str, begin, length);
+			layLine(line, k, charY);
+			replaceVertices(i, line.offsets[k]);
 		}
-		break;
-	default:
-		assert(false && "class Text: Unhandled align case");
+		begin = end + 1;
 	}
-
-	// Load into GL
+	if (lines.size() > nLines)
 	{
-		glBindBuffer(GL_ARRAY_BUFFER, bufferVert);
-		glBufferData(GL_ARRAY_BUFFER,
-		             vertices.size() * sizeof(Vector2f),
-		             vertices.data(),
-		             GL_DYNAMIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, bufferUV);
-		glBufferData(GL_ARRAY_BUFFER,
-		             uv.size() * sizeof(Vector2f),
-		             uv.data(),
-		             GL_DYNAMIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, bufferLayers);
-		glBufferData(GL_ARRAY_BUFFER,
-		             layers.size() * sizeof(GLuint),
-		             layers.data(),
-		             GL_DYNAMIC_DRAW);
-		nIndices = generateQuadElementIndices(&bufferIndices, vertices.size());
+		vertices.resize(nLines ? lines[nLines].first : 0);
+		lines.resize(nLines);
 	}
+	hasGeometry = !vertices.empty();
 }
 
-bool Text::loadLine(std::vector<Vector2f>* vertices,
-                    std::vector<Vector2f>* uv,
-                    std::vector<GLuint>* layers,
-                    float charX, float charY, Align align,
-                    String str,
-                    float const ratioW, float const ratioH) const
+void Text::layLine(Line& line, std::size_t k, float charY)
 {
-	if (str.empty()) return false;
-
-
-	bool flag = false; // Does this line have geometry?
+	scratch.clear();
+	std::size_t const n = line.text.size();
+	line.pens.resize(n + 1);
+	line.offsets.resize(n + 1);
+	if (k == 0)
+	{
+		line.pens[0] = Vector2f(x, charY);
+		line.offsets[0] = 0;
+	}
 
-	switch (align)
+	// Appends the glyph of c at the pen, returning its advance
+	auto glyph = [this](char c, Vector2f const& pen)
 	{
-	case BOT_LEFT:
-	case TOP_LEFT:
-		for (auto const& c : str)
+		// Texture parameters
+		GLuint w;
+		float u0, u1, v0, v1;
+		// Glyph parameters
+		float ax, ay, sx, sy, mx, my;
+
+		bool hasVolume = font->getChar(&w,
+		                               &u0, &u1,
+		                               &v0, &v1,
+		                               &ax, &ay,
+		                               &sx, &sy,
+		                               &mx, &my,
+		                               (unsigned char) c);
+		if (hasVolume)
 		{
-			// Texture parameters
-			GLuint w;
-			float u0, u1, v0, v1;
-			// Glyph parameters
-			float ax, ay, sx, sy, mx, my;
-
-			bool hasVolume = font->getChar(&w,
-			                               &u0, &u1,
-			                               &v0, &v1,
-			                               &ax, &ay,
-			                               &sx, &sy,
-			                               &mx, &my,
-			                               c);
-			if (!hasVolume) continue;
-
-			flag = true;
-			// Insert Geometry into graphics
-
-			float x2 = charX + mx * ratioW;
-			float y2 = charY + my * ratioH;
+			float x2 = pen.x() + mx * ratioW;
+			float y2 = pen.y() + my * ratioH;
 			float charW = sx * ratioW;
 			float charH = sy * ratioH;
 
-			vertices->push_back(Vector2f(x2,         y2));
-			vertices->push_back(Vector2f(x2,         y2 - charH));
-			vertices->push_back(Vector2f(x2 + charW, y2 - charH));
-			vertices->push_back(Vector2f(x2 + charW, y2));
-
-			uv->push_back(Vector2f(u0, v0));
-			uv->push_back(Vector2f(u0, v1));
-			uv->push_back(Vector2f(u1, v1));
-			uv->push_back(Vector2f(u1, v0));
-
-			layers->push_back(w);
-			layers->push_back(w);
-			layers->push_back(w);
-			layers->push_back(w);
-
-			// Move pointer
-			charX += ax * ratioW;
-			charY += ay * ratioH;
+			scratch.push_back({x2,         y2,         u0, v0, (float) w, 0});
+			scratch.push_back({x2,         y2 - charH, u0, v1, (float) w, 0});
+			scratch.push_back({x2 + charW, y2 - charH, u1, v1, (float) w, 0});
+			scratch.push_back({x2 + charW, y2,         u1, v0, (float) w, 0});
 		}
-		break;
-	case BOT_RIGHT:
-	case TOP_RIGHT:
-		std::reverse(str.begin(), str.end());
-		for (auto const& c : str)
-		{
-			// Texture parameters
-			GLuint w;
-			float u0, u1, v0, v1;
-			// Glyph parameters
-			float ax, ay, sx, sy, mx, my;
-
-			bool hasVolume = font->getChar(&w,
-			                               &u0, &u1,
-			                               &v0, &v1,
-			                               &ax, &ay,
-			                               &sx, &sy,
-			                               &mx, &my,
-			                               c);
-			if (!hasVolume) continue;
-
-			flag = true;
-			// Insert Geometry into graphics
+		return Vector2f(ax * ratioW, ay * ratioH);
+	};
 
-			float x2 = charX + mx * ratioW;
-			float y2 = charY + my * ratioH;
-			float charW = sx * ratioW;
-			float charH = sy * ratioH;
-
-			vertices->push_back(Vector2f(x2,         y2));
-			vertices->push_back(Vector2f(x2,         y2 - charH));
-			vertices->push_back(Vector2f(x2 + charW, y2 - charH));
-			vertices->push_back(Vector2f(x2 + charW, y2));
-			uv->push_back(Vector2f(u0, v0));
-			uv->push_back(Vector2f(u0, v1));
-			uv->push_back(Vector2f(u1, v1));
-			uv->push_back(Vector2f(u1, v0));
-
-			layers->push_back(w);
-			layers->push_back(w);
-			layers->push_back(w);
-			layers->push_back(w);
+	if (align == BOT_RIGHT || align == TOP_RIGHT)
+	{
+		// Laid out backwards from the end, so always in whole. The pens are
+		// not used.
+		assert(k == 0 && "class Text: Right aligned lines change in whole");
+		Vector2f pen(x - font->getCharAdvX((unsigned char) back) * ratioW,
+		             charY);
+		for (auto it = line.text.rbegin(); it != line.text.rend(); ++it)
+			pen -= glyph(*it, pen);
+		line.offsets[n] = scratch.size();
+		return;
+	}
 
-			// Move pointer
-			charX -= ax * ratioW;
-			charY -= ay * ratioH;
-		}
-		break;
-	default:
-		assert(false && "class Text: Unhandled align case");
+	std::size_t const offset = line.offsets[k];
+	Vector2f pen = line.pens[k];
+	for (std::size_t i = k; i < n; ++i)
+	{
+		line.pens[i] = pen;
+		line.offsets[i] = offset + scratch.size();
+		pen += glyph(line.text[i], pen);
+	}
+	line.pens[n] = pen;
+	line.offsets[n] = offset + scratch.size();
+}
+void Text::replaceVertices(std::size_t i, std::size_t offset)
+{
+	Line& line = lines[i];
+	auto const from = vertices.begin() + line.first + offset;
+	std::size_t const nOld = line.nVertices - offset;
+	if (scratch.size() == nOld)
+	{
+		// Same glyph count: in place
+		std::copy(scratch.begin(), scratch.end(), from);
+		return;
 	}
 
-	return flag;
+	vertices.erase(from, from + nOld);
+	vertices.insert(vertices.begin() + line.first + offset,
+	                scratch.begin(), scratch.end());
+	line.nVertices = offset + scratch.size();
+	for (std::size_t j = i + 1; j < lines.size(); ++j)
+		lines[j].first = lines[j].first + scratch.size() - nOld;
 }
 
 } // namespace fab
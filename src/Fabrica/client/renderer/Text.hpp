@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "Font.hpp"
+#include "UIBatch.hpp"
 #include "../../common/fabrica.hpp"
 #include "../../util/vector.hpp"
 
@@ -16,25 +17,17 @@ namespace fab
 /**
  * @brief Handles text drawing with OpenGL
  * @warning
- *  Call {@code init()} before using this class. An OpenGL context must be
- *  present when drawing.
+ *  An OpenGL context must be present when drawing.
  *
  * This class differs from Font since it bridges between Font and Window.
- *
- * TODO: Remove all the GL_ERROR_CHECKs
+ * The laid out glyphs are kept in memory and added to the
+ * {@code UIBatch} on each draw. {@code setContents} only lays out again the
+ * lines that changed, and in left aligned lines only from the first changed
+ * character on. All of it is laid out again once the font evicts a glyph.
  */
 class Text final
 {
 public:
-	/**
-	 * @brief Initialises the shaders.
-	 * @warning
-	 *  Must be called after loading OpenGL context and before any other
-	 *  invocation to this class.
-	 *
-	 * This function asserts that the shaders will be compiled correctly.
-	 */
-	static void init();
 	/*
 	 * Describe how is the position of the text relative to the set position of
 	 * the text.
@@ -49,46 +42,77 @@ public:
 
 	Text() noexcept;
 	Text(Font const* const font) noexcept;
-	~Text();
 
-	void draw() const; // Draw with color=white.
-	void draw(float color[]) const;
+	void draw(); // Draw with color=white.
+	/**
+	 * @brief Adds the text to the {@code UIBatch}, laying it out again first
+	 *  if the font has changed since.
+	 */
+	void draw(float color[]);
 
-	void setContents(float x, float y, Align align, String str) noexcept;
+	void setContents(float x, float y, Align align,
+	                 String const& str);
+	/**
+	 * @brief Sets the size of the text laid out from now on, in pixels. 0,
+	 *  the default, is the size of the font.
+	 *
+	 * Sharp at any size with a signed distance field font.
+	 */
+	void setSize(unsigned int size) noexcept { this->size = size; }
 
-private:
 	/**
-	 * @brief Loads a line of text into the geometry.
-	 * @return True if any geometry is added.
+	 * @brief Laid out glyphs, four vertices each.
 	 */
-	bool loadLine(std::vector<Vector2f>* vertices,
-	              std::vector<Vector2f>* uv,
-	              std::vector<GLuint>* w,
-	              float x, float y, Align align,
-	              String str,
-	              float const ratioW, float const ratioH) const;
+	std::vector<UIBatch::Vertex> const& getVertices() const noexcept
+	{
+		return vertices;
+	}
+
+private:
+	struct Line
+	{
+		String text;
+		std::size_t first; ///< First vertex in vertices
+		std::size_t nVertices;
+		/// Pen position before each character, and after the last one
+		std::vector<Vector2f> pens;
+		/// Vertices (from first) before each character, and after the last one
+		std::vector<std::size_t> offsets;
+	};
 
 	/**
-	 * Default 2D text drawing shader.
+	 * @brief Lays out str, keeping the lines that are still valid.
 	 */
-	static GLuint program;
+	void layOut(float x, float y, Align align, String const& str);
 	/**
-	 * Color parameter in {@code program}.
+	 * @brief Lays out the characters of a line from the k-th on into
+	 *  scratch. The pens and offsets up to k must be valid.
 	 */
-	static GLuint programPColor;
-	static GLuint buffer; ///< GL buffer for text rectangle
+	void layLine(Line& line, std::size_t k, float charY);
+	/**
+	 * @brief Replaces the vertices of line i from its offset-th vertex on with
+	 *  scratch.
+	 */
+	void replaceVertices(std::size_t i, std::size_t offset);
 
 	Font const* font;
 	Align align;
+	unsigned int size; ///< 0 for the size of the font
+
+	// Parameters of the current layout
+	float x, y;
+	float ratioW, ratioH;
+	unsigned int fontSize;
+	char back; ///< Last character, which right alignment depends on
+	std::uint64_t generation; ///< Of the font
 
 	// If false, the drawing routine is skipped.
 	bool hasGeometry;
 
-	/*
-	 * Buffers for drawing textures
-	 */
-	GLuint bufferVert, bufferUV, bufferLayers, bufferIndices;
-	unsigned int nIndices;
+	std::vector<Line> lines;
+	/// Four per glyph, with no colour
+	std::vector<UIBatch::Vertex> vertices;
+	std::vector<UIBatch::Vertex> scratch;
 };
 
 } // namespace fab
@@ -1,5 +1,6 @@
 #include "TextureAtlas.hpp"
 
+#include <algorithm>
 #include <cassert>
 
 #include "utils.hpp"
@@ -7,16 +8,103 @@
 namespace fab
 {
 
+namespace
+{
+
+/**
+ * Smallest power of 2 whose square is at least n, up to max.
+ */
+int squareSide(int n, int max) noexcept
+{
+	int side = 1;
+	while (side * side < n && side < max)
+		side *= 2;
+	return side;
+}
+/**
+ * Number of times the cells can be halved evenly, plus the base level,
+ * stopping at charts of 1 pixel.
+ */
+int mipLevels(int chartW, int chartH, int cellW, int cellH) noexcept
+{
+	int levels = 1;
+	while (cellW % 2 == 0 && cellH % 2 == 0 &&
+	       (chartW >> levels) > 0 && (chartH >> levels) > 0)
+	{
+		cellW /= 2;
+		cellH /= 2;
+		++levels;
+	}
+	return levels;
+}
+
+} // namespace
+
+constexpr int const TextureAtlas::planeMax;
+
 TextureAtlas::TextureAtlas(int chartW, int chartH,
                              int planeW, int planeH,
-                             int depth):
+                             int depth, int padding):
 	chartW(chartW), chartH(chartH),
+	padding(padding),
+	cellW(chartW + 2 * padding), cellH(chartH + 2 * padding),
 	planeW(planeW), planeH(planeH),
 	nChartsInPlane(planeW * planeH),
-	width(chartW * planeW), height(chartH * planeH), depth(depth)
-#ifndef NDEBUG
-	,maxCharts(width * height * depth)
-#endif
+	width(cellW * planeW), height(cellH * planeH), depth(depth),
+	levels(mipLevels(chartW, chartH, cellW, cellH))
+{
+	texture = allocate(depth);
+}
+TextureAtlas::TextureAtlas(int chartW, int chartH, int nCharts,
+                           int padding):
+	TextureAtlas(chartW, chartH,
+	             squareSide(nCharts, planeMax), squareSide(nCharts, planeMax),
+	             std::max(1, (nCharts + planeMax * planeMax - 1) /
+	                         (planeMax * planeMax)),
+	             padding)
+{
+}
+TextureAtlas::~TextureAtlas()
+{
+	glDeleteTextures(1, &texture);
+}
+
+std::size_t TextureAtlas::footprint(int chartW, int chartH, int nCharts,
+                                    int padding) noexcept
+{
+	int const side = squareSide(nCharts, planeMax);
+	int const depth = std::max(1, (nCharts + planeMax * planeMax - 1) /
+	                              (planeMax * planeMax));
+	int const cellW = chartW + 2 * padding;
+	int const cellH = chartH + 2 * padding;
+	int const levels = mipLevels(chartW, chartH, cellW, cellH);
+
+	std::size_t bytes = 0;
+	for (int level = 0; level < levels; ++level)
+		bytes += (std::size_t) ((cellW * side) >> level) *
+		         ((cellH * side) >> level) * depth * 4; // RGBA8
+	return bytes;
+}
+int TextureAtlas::planeWidth(int chartW, int nCharts, int padding) noexcept
+{
+	return (chartW + 2 * padding) * squareSide(nCharts, planeMax);
+}
+void TextureAtlas::grow(int newDepth)
+{
+	if (newDepth <= depth) return;
+
+	GLuint const grown = allocate(newDepth);
+	for (int level = 0; level < levels; ++level)
+		glCopyImageSubData(texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+		                   grown, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+		                   width >> level, height >> level, depth);
+	glDeleteTextures(1, &texture);
+	texture = grown;
+	depth = newDepth;
+
+	GL_ERROR_CHECK;
+}
+GLuint TextureAtlas::allocate(int depth) const
 {
 #ifndef NDEBUG
 	{
@@ -38,8 +126,9 @@ TextureAtlas::TextureAtlas(int chartW, int chartH,
 	}
 #endif
 	// Active and generate the texture
-	glGenTextures(1, &texture);
-	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	GLuint t;
+	glGenTextures(1, &t);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, t);
 
 	// Sets the alignment.
 	// In our case, the default alignment of 4 suffices.
@@ -48,54 +137,119 @@ TextureAtlas::TextureAtlas(int chartW, int chartH,
 	/*
 	 * Generates the texture storage
 	 *
-	 * Warning: The mipmap level makes some assumptions on the
-	 * minimal size of chartW * planeW, etc.
+	 * The cells are halved evenly on every level (see mipLevels), so each
+	 * level holds exactly planeW x planeH cells.
 	 */
-	glTextureStorage3D(texture, // Texture
-	                   1, // Mipmap level = 1
+	glTextureStorage3D(t, // Texture
+	                   levels, // Mipmap levels
 	                   GL_RGBA8, // Format
 	                   width, height, depth // Dimensions
 	                   );
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+	                GL_NEAREST_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
 	GL_ERROR_CHECK;
-}
-TextureAtlas::~TextureAtlas()
-{
-	glDeleteTextures(1, &texture);
+	return t;
 }
 
-void TextureAtlas::loadChart(int chartId, void* pixels)
+void TextureAtlas::loadCharts(int first, int n, void const* pixels)
 {
-#ifndef NDEBUG
-	assert(chartId < maxCharts &&
-			"chartId exceeded limit");
-#endif
-	int x, y, z;
+	assert(first >= 0 && n >= 0 && "class TextureAtlas: Invalid chart range");
+	int const end = first + n;
+	if (end > getCapacity())
+		grow(std::max(2 * depth, (end - 1) / nChartsInPlane + 1));
 
-	{ // Break chartId down into components
-		z = chartId / nChartsInPlane;
-		int planeId = chartId % nChartsInPlane;
-		y = planeId / planeW;
-		x = planeId % planeW;
+	auto const* const in = static_cast<std::uint8_t const*>(pixels);
+	std::size_t const chartBytes = chartW * chartH * 4;
+	// Each plane takes at most three rectangles of cells: the end of a row,
+	// whole rows and the beginning of a row.
+	for (int chartId = first; chartId < end;)
+	{
+		int const z = chartId / nChartsInPlane;
+		int const planeId = chartId % nChartsInPlane;
+		int const x = planeId % planeW;
+		int const y = planeId / planeW;
+		int cols, rows;
+		if (x > 0 || end - chartId < planeW)
+		{
+			cols = std::min(planeW - x, end - chartId);
+			rows = 1;
+		}
+		else
+		{
+			cols = planeW;
+			rows = std::min(planeH - y, (end - chartId) / planeW);
+		}
+		loadCells(x, y, z, cols, rows, in + (chartId - first) * chartBytes);
+		chartId += cols * rows;
 	}
 
-	glTextureSubImage3D(texture, // Target
-			0, // Mipmap level
-			x * chartW, // Offset X
-			y * chartH, // Offset Y
-			z,            // Offset Z
-			chartW,       // Size X
-			chartH,       // Size Y
-			1,            // Size Z
-			GL_RGBA,     // Type
-			GL_UNSIGNED_BYTE, // Input type
-			pixels);
-
 	GL_ERROR_CHECK;
 }
+void TextureAtlas::loadCells(int x, int y, int z, int cols, int rows,
+                             std::uint8_t const* charts)
+{
+	// Pads the charts into their cells, repeating the border into the gutter
+	int const rectW = cols * cellW;
+	int const rectH = rows * cellH;
+	std::vector<std::uint8_t> rect(rectW * rectH * 4);
+	for (int r = 0; r < rows; ++r)
+		for (int c = 0; c < cols; ++c)
+		{
+			std::uint8_t const* const chart =
+			  charts + (r * cols + c) * chartW * chartH * 4;
+			std::uint8_t* const cell =
+			  &rect[(r * cellH * rectW + c * cellW) * 4];
+			for (int j = 0; j < cellH; ++j)
+			{
+				int const sj = std::min(std::max(j - padding, 0), chartH - 1);
+				for (int i = 0; i < cellW; ++i)
+				{
+					int const si = std::min(std::max(i - padding, 0), chartW - 1);
+					std::copy_n(chart + (sj * chartW + si) * 4, 4,
+					            cell + (j * rectW + i) * 4);
+				}
+			}
+		}
+
+	// The cells halve evenly, so halving the whole rectangle never mixes
+	// two of them.
+	for (int level = 0; level < levels; ++level)
+	{
+		if (level > 0)
+			downsample(rect, rectW >> (level - 1), rectH >> (level - 1));
+		glTextureSubImage3D(texture, // Target
+				level, // Mipmap level
+				(x * cellW) >> level, // Offset X
+				(y * cellH) >> level, // Offset Y
+				z,            // Offset Z
+				rectW >> level, // Size X
+				rectH >> level, // Size Y
+				1,            // Size Z
+				GL_RGBA,     // Type
+				GL_UNSIGNED_BYTE, // Input type
+				rect.data());
+	}
+}
+void TextureAtlas::downsample(std::vector<std::uint8_t>& pixels,
+                              int width, int height) noexcept
+{
+	// In place: each pixel is written after the four it is made of are read.
+	int const w = width / 2, h = height / 2;
+	for (int j = 0; j < h; ++j)
+		for (int i = 0; i < w; ++i)
+			for (int c = 0; c < 4; ++c)
+			{
+				int const p = ((2 * j) * width + 2 * i) * 4 + c;
+				int const sum = pixels[p] + pixels[p + 4] +
+				                pixels[p + width * 4] + pixels[p + width * 4 + 4];
+				pixels[(j * w + i) * 4 + c] = (sum + 2) / 4;
+			}
+	pixels.resize(w * h * 4);
+}
 
 } // namespace fab
@@ -1,16 +1,30 @@
 #ifndef FABRICA_CLIENT_RENDERER_TEXTUREATLAS_HPP_
 #define FABRICA_CLIENT_RENDERER_TEXTUREATLAS_HPP_
 
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 #include <GL/glew.h>
 
 namespace fab
 {
 
 /**
- * @brief Fixed-dimension Texture Atlas
+ * @brief Texture Atlas of fixed-size charts
+ *
+ * The atlas grows by whole planes when a chart beyond its capacity is loaded.
+ * Growing replaces the internal texture, but keeps the UVW coordinates of the
+ * charts already loaded.
+ *
+ * Each chart sits in a cell surrounded by a gutter of padding pixels, which
+ * repeat the border of the chart. Every mipmap level is generated chart by
+ * chart from the padded cell, so that filtering never mixes neighbouring
+ * charts. The atlas has as many levels as the cells can be halved evenly,
+ * down to 1 pixel per chart, and is sampled with GL_NEAREST_MIPMAP_LINEAR.
  *
  * Internal parameters:
- * Mipmap level = 1
  * Format = GL_RGBA8 (RGB + Alpha, 8bits/chan)
  */
 class TextureAtlas final
@@ -28,11 +42,19 @@ public:
 	 * @param[in] planeW Number (Horizontal) of charts in each plane.
 	 * @param[in] planeH Number (Vertical) of charts in each plane
 	 * @param[in] depth Number of planes
-	 *
+	 * @param[in] padding Width of the gutter around each chart
 	 */
 	TextureAtlas(int chartW, int chartH,
 	             int planeW, int planeH,
-	             int depth);
+	             int depth, int padding = 0);
+	/**
+	 * @brief Creates a texture atlas holding at least nCharts charts.
+	 *
+	 * The planes are the smallest squares of a power of 2 charts (up to
+	 * planeMax per side) that hold the charts, so that a small atlas takes
+	 * little memory.
+	 */
+	TextureAtlas(int chartW, int chartH, int nCharts, int padding = 0);
 	/**
 	 * Deletes the internal GL texture.
 	 */
@@ -53,7 +75,39 @@ public:
 	 * @param[in] chartId The id of the chart.
 	 * @param[in] pixels Pixels
 	 */
-	void loadChart(int chartId, void* pixels);
+	void loadChart(int chartId, void const* pixels);
+	/**
+	 * @brief Loads the n charts from first on, whose pixels follow each other
+	 *  in pixels, in a few uploads of whole rows of cells.
+	 *
+	 * Grows the atlas at most once.
+	 */
+	void loadCharts(int first, int n, void const* pixels);
+
+	/**
+	 * @brief Number of charts that fit without growing.
+	 */
+	int getCapacity() const noexcept { return nChartsInPlane * depth; }
+	/**
+	 * @brief Number of mipmap levels.
+	 */
+	int getLevels() const noexcept { return levels; }
+	/**
+	 * @brief Adds planes until there are at least depth planes, copying the
+	 *  charts already loaded. Binds the new texture.
+	 */
+	void grow(int depth);
+	/**
+	 * @brief Bytes of video memory taken by the atlas that the nCharts
+	 *  constructor creates with these parameters, all levels included.
+	 */
+	static std::size_t footprint(int chartW, int chartH, int nCharts,
+	                             int padding = 0) noexcept;
+	/**
+	 * @brief Width in pixels of the planes that the nCharts constructor
+	 *  creates with these parameters.
+	 */
+	static int planeWidth(int chartW, int nCharts, int padding = 0) noexcept;
 
 
 	/**
@@ -71,22 +125,42 @@ public:
 	              float* const v0, float* const v1,
 	              int chartId) const noexcept;
 
+	/// Maximum number of charts per side of a plane, for automatic sizing
+	static constexpr int const planeMax = 256;
+
 private:
+	/**
+	 * @brief Generates and binds a texture with the dimensions of the atlas
+	 *  and the given number of planes.
+	 */
+	GLuint allocate(int depth) const;
+	/**
+	 * @brief Pads the charts into the rectangle of cols x rows cells from
+	 *  cell [x, y] of plane z and uploads every level of it.
+	 */
+	void loadCells(int x, int y, int z, int cols, int rows,
+	               std::uint8_t const* charts);
+	/**
+	 * @brief Halves the width x height RGBA8 pixels with a box filter.
+	 */
+	static void downsample(std::vector<std::uint8_t>& pixels,
+	                       int width, int height) noexcept;
+
 	GLuint texture;
 
 	int chartW, chartH; // Width/Height of a chart
+	int padding;
+	int cellW, cellH; // Always = chartW/H + 2 * padding
 	int planeW, planeH; // Number of charts in a plane,
 	// Horizontally and Vertically
 	int nChartsInPlane; // Always = planeW * planeH
 	/*
-	 * width = chartW * planeW
-	 * height = chartH * planeH
+	 * width = cellW * planeW
+	 * height = cellH * planeH
 	 * depth = Number of planes
 	 */
 	int width, height, depth;
-#ifndef NDEBUG
-	int maxCharts;
-#endif
+	int levels; // Mipmap levels
 };
 
 // Implementations
@@ -97,6 +171,11 @@ inline void TextureAtlas::loadTexture()
 	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
 }
 
+inline void TextureAtlas::loadChart(int chartId, void const* pixels)
+{
+	assert(chartId >= 0 && "chartId is negative");
+	loadCharts(chartId, 1, pixels);
+}
 inline void TextureAtlas::chartUVW(GLuint* const w,
                                    float* const u0, float* const u1,
                                    float* const v0, float* const v1,
@@ -108,10 +187,11 @@ inline void TextureAtlas::chartUVW(GLuint* const w,
 	int x = planeId % planeW;
 	int y = planeId / planeW;
 
-	*u0 = (x * chartW) / (float) width;
-	*v0 = (y * chartH) / (float) height;
-	*u1 = ((x + 1) * chartW - 1) / (float) width;
-	*v1 = ((y + 1) * chartH - 1) / (float) height;
+	// The gutters keep the edges of the chart from bleeding.
+	*u0 = (x * cellW + padding) / (float) width;
+	*v0 = (y * cellH + padding) / (float) height;
+	*u1 = (x * cellW + padding + chartW) / (float) width;
+	*v1 = (y * cellH + padding + chartH) / (float) height;
 }
 
 } // namespace fab
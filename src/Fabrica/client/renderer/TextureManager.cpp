@@ -3,10 +3,28 @@
 namespace fab
 {
 
-TextureManager::TextureManager(int blockSize):
-	blockSize(blockSize),
-	textureBlock(blockSize, blockSize, 256, 256, 16)
+constexpr int const TextureManager::minBlockSize;
+constexpr int const TextureManager::maxBlockSize;
+constexpr std::size_t const TextureManager::defaultBudget;
+
+TextureManager::TextureManager(int nBlockCharts, int blockSize):
+	textureBlock(blockSize, blockSize, nBlockCharts, blockPadding(blockSize)),
+	blockSize(blockSize)
+{
+}
+
+int TextureManager::blockSizeFor(int nBlockCharts, int sourceSize,
+                                 std::size_t budget,
+                                 int maxTextureSize) noexcept
 {
+	int size = minBlockSize;
+	while (size < maxBlockSize && size * 2 <= sourceSize &&
+	       TextureAtlas::footprint(size * 2, size * 2, nBlockCharts,
+	                               blockPadding(size * 2)) <= budget &&
+	       TextureAtlas::planeWidth(size * 2, nBlockCharts,
+	                                blockPadding(size * 2)) <= maxTextureSize)
+		size *= 2;
+	return size;
 }
 
 
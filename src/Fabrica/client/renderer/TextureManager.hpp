@@ -1,6 +1,8 @@
 #ifndef FABRICA_CLIENT_RENDERER_TEXTUREMANAGER_HPP_
 #define FABRICA_CLIENT_RENDERER_TEXTUREMANAGER_HPP_
 
+#include <cstddef>
+
 #include "TextureAtlas.hpp"
 
 namespace fab
@@ -12,11 +14,41 @@ namespace fab
 class TextureManager final
 {
 public:
-	TextureManager(int blockSize = 16);
+	/**
+	 * @param[in] nBlockCharts Expected number of block charts, which sizes
+	 *  the block atlas. The atlas grows if more are loaded.
+	 */
+	TextureManager(int nBlockCharts, int blockSize = minBlockSize);
+
+	/// Bounds of the chart size of blocks, in pixels
+	static constexpr int const minBlockSize = 16;
+	static constexpr int const maxBlockSize = 256;
+	/// Video memory for the block atlas, unless configured
+	static constexpr std::size_t const defaultBudget = 64 << 20;
+
+	/**
+	 * @brief Picks the chart size of the block atlas.
+	 *
+	 * The largest power of 2 from minBlockSize to maxBlockSize, and no larger
+	 * than the largest texture, whose atlas of nBlockCharts fits in budget
+	 * bytes and has planes of at most maxTextureSize pixels. minBlockSize if
+	 * none fits.
+	 *
+	 * @param[in] sourceSize Largest width or height of the textures
+	 * @param[in] maxTextureSize GL_MAX_TEXTURE_SIZE
+	 */
+	static int blockSizeFor(int nBlockCharts, int sourceSize,
+	                        std::size_t budget, int maxTextureSize) noexcept;
 
 	int getBlockSize() const noexcept { return blockSize; }
 	TextureAtlas& getTextureBlock() noexcept;
 private:
+	/**
+	 * @brief Gutter around the block charts. Half a chart makes the cells
+	 *  twice the charts, so that they halve evenly down to charts of 1 pixel.
+	 */
+	static int blockPadding(int blockSize) noexcept { return blockSize / 2; }
+
 	TextureAtlas textureBlock;
 
 	int blockSize;
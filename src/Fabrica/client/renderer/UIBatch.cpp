@@ -0,0 +1,176 @@
+#include "UIBatch.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "utils.hpp"
+
+namespace fab
+{
+
+constexpr std::size_t const UIBatch::nRegions;
+constexpr std::size_t const UIBatch::regionQuads;
+
+GLuint UIBatch::program;
+GLuint UIBatch::programPSDF;
+GLuint UIBatch::buffer;
+GLuint UIBatch::bufferIndices;
+UIBatch::Vertex* UIBatch::mapping = nullptr;
+GLsync UIBatch::fences[nRegions] = {};
+std::size_t UIBatch::region = 0;
+std::size_t UIBatch::first = 0;
+std::size_t UIBatch::end = 0;
+GLuint UIBatch::texture = 0;
+bool UIBatch::sdf = false;
+std::uint64_t UIBatch::nDraws = 0;
+
+void UIBatch::init()
+{
+	char const sourceVert[] =
+	  "#version 330 core\n"
+	  "layout(location = 0) in vec2 position;"
+	  "layout(location = 1) in vec3 uvwIn;"
+	  "layout(location = 2) in vec4 colourIn;"
+	  "out vec3 uvw;"
+	  "out vec4 colour;"
+	  "void main()"
+	  "{"
+	  "gl_Position = vec4(position, 0, 1);"
+	  "uvw = uvwIn;"
+	  "colour = colourIn;"
+	  "}";
+	char const sourceFrag[] =
+	  "#version 330 core\n"
+	  "in vec3 uvw;"
+	  "in vec4 colour;"
+	  "out vec4 color;"
+	  "uniform sampler2DArray sampler;"
+	  "uniform bool sdf;"
+	  "void main()"
+	  "{"
+	  // Derivatives are taken outside of the branches.
+	  "float a = texture(sampler, uvw).r;"
+	  "float w = 0.7 * fwidth(a);"
+	  "if (uvw.z < 0)"
+	  "  color = colour;"
+	  "else"
+	  // The outline of a distance field is at 0.5, antialiased over about
+	  // one screen pixel.
+	  "  color = vec4(1,1,1, sdf ? smoothstep(0.5 - w, 0.5 + w, a) : a) *"
+	  "          colour;"
+	  "}";
+	bool flag = registerGLProgram(&program, sourceVert, sourceFrag);
+	assert(flag && "class UIBatch: GL Program register failed");
+	(void) flag;
+	programPSDF = glGetUniformLocation(program, "sdf");
+
+	GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+	                         GL_MAP_COHERENT_BIT;
+	GLsizeiptr const size = nRegions * regionQuads * 4 * sizeof(Vertex);
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+	mapping = static_cast<Vertex*>(
+	            glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+	assert(mapping && "class UIBatch: Buffer mapping failed");
+
+	// Every draw starts at the first index, offset by its base vertex.
+	glGenBuffers(1, &bufferIndices);
+	generateQuadElementIndices(&bufferIndices, regionQuads);
+
+	GL_ERROR_CHECK;
+}
+
+void UIBatch::addRect(float x0, float y0, float x1, float y1,
+                      std::uint32_t colour)
+{
+	Vertex* const v = reserve(4);
+	v[0] = Vertex{x0, y0, 0.f, 0.f, -1.f, colour};
+	v[1] = Vertex{x0, y1, 0.f, 0.f, -1.f, colour};
+	v[2] = Vertex{x1, y1, 0.f, 0.f, -1.f, colour};
+	v[3] = Vertex{x1, y0, 0.f, 0.f, -1.f, colour};
+}
+void UIBatch::addQuads(GLuint texture, bool sdf,
+                       Vertex const* vertices, std::size_t nVertices,
+                       std::uint32_t colour)
+{
+	assert(nVertices % 4 == 0 && "class UIBatch: Incomplete quad");
+	// Flat rectangles go with any texture.
+	if (UIBatch::texture != texture || UIBatch::sdf != sdf)
+	{
+		if (UIBatch::texture)
+			flush();
+		UIBatch::texture = texture;
+		UIBatch::sdf = sdf;
+	}
+
+	while (nVertices > 0)
+	{
+		std::size_t const n = std::min(nVertices, regionQuads * 4);
+		Vertex* const v = reserve(n);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			v[i] = vertices[i];
+			v[i].colour = colour;
+		}
+		vertices += n;
+		nVertices -= n;
+	}
+}
+void UIBatch::flush()
+{
+	if (end == first) return;
+
+	glUseProgram(program);
+	glUniform1i(programPSDF, sdf);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+	glEnableVertexAttribArray(0); // Position array
+	glEnableVertexAttribArray(1); // UVW array
+	glEnableVertexAttribArray(2); // Colour array
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+	                      (void*) offsetof(Vertex, x));
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+	                      (void*) offsetof(Vertex, u));
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex),
+	                      (void*) offsetof(Vertex, colour));
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferIndices);
+	glDrawElementsBaseVertex(GL_TRIANGLES, (end - first) / 4 * 6,
+	                         GL_UNSIGNED_INT, nullptr, first);
+
+	glDisableVertexAttribArray(0);
+	glDisableVertexAttribArray(1);
+	glDisableVertexAttribArray(2);
+
+	first = end;
+	++nDraws;
+}
+
+UIBatch::Vertex* UIBatch::reserve(std::size_t n)
+{
+	assert(n <= regionQuads * 4 && "class UIBatch: Too many vertices");
+	if (end + n > (region + 1) * regionQuads * 4)
+	{
+		flush();
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		region = (region + 1) % nRegions;
+		if (fences[region])
+		{
+			// Usually long finished, since the other regions were drawn since.
+			glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT,
+			                 GL_TIMEOUT_IGNORED);
+			glDeleteSync(fences[region]);
+			fences[region] = nullptr;
+		}
+		first = end = region * regionQuads * 4;
+	}
+	Vertex* const v = mapping + end;
+	end += n;
+	return v;
+}
+
+} // namespace fab
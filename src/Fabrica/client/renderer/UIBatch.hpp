@@ -0,0 +1,98 @@
+#ifndef FABRICA_CLIENT_RENDERER_UIBATCH_HPP_
+#define FABRICA_CLIENT_RENDERER_UIBATCH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+namespace fab
+{
+
+/**
+ * @brief Collects the 2D quads of a frame (rectangles and glyphs) and draws
+ *  them in as few calls as possible.
+ * @warning Call {@code init()} before using this class. An OpenGL context
+ *  must be present.
+ *
+ * The quads are written straight into a persistently mapped buffer of
+ * nRegions regions, used in turn. A fence guards each region, so the buffer
+ * is never overwritten while the GPU still reads it. Quads are drawn when
+ * their texture changes, when a region fills up and on {@code flush()},
+ * which {@code Window::swapBuffers} calls, in the order they are added.
+ *
+ * Coordinates are normalised device coordinates.
+ */
+class UIBatch final
+{
+public:
+	/**
+	 * @brief Vertex of a quad. Untextured if w is negative.
+	 */
+	struct Vertex
+	{
+		float x, y;
+		float u, v, w; ///< Coordinates in an array texture
+		std::uint32_t colour; ///< In 0xAABBGGRR format
+	};
+
+	static constexpr std::size_t const nRegions = 3;
+	static constexpr std::size_t const regionQuads = 8192;
+
+	/**
+	 * @brief Initialises the shader and the buffers.
+	 * @warning Must be called after creation of OpenGL context
+	 */
+	static void init();
+
+	/**
+	 * @brief Adds a rectangle of a flat colour.
+	 */
+	static void addRect(float x0, float y0, float x1, float y1,
+	                    std::uint32_t colour);
+	/**
+	 * @brief Adds the quads of the four vertices each in vertices, sampling
+	 *  the red channel of an array texture as alpha.
+	 * @param[in] sdf Whether the texture is a signed distance field.
+	 * @param[in] colour Replaces the colour of the vertices.
+	 */
+	static void addQuads(GLuint texture, bool sdf,
+	                     Vertex const* vertices, std::size_t nVertices,
+	                     std::uint32_t colour);
+	/**
+	 * @brief Draws the quads added since the last draw.
+	 */
+	static void flush();
+
+	/**
+	 * @brief Number of draw calls since init.
+	 */
+	static std::uint64_t getNDraws() noexcept { return nDraws; }
+
+private:
+	UIBatch() = delete;
+
+	/**
+	 * @brief Makes room for n vertices (at most a region), drawing the
+	 *  pending quads and moving to the next region if they do not fit.
+	 */
+	static Vertex* reserve(std::size_t n);
+
+	static GLuint program;
+	static GLuint programPSDF;
+	static GLuint buffer;
+	static GLuint bufferIndices;
+	static Vertex* mapping;
+	static GLsync fences[nRegions];
+
+	static std::size_t region; ///< Current region
+	static std::size_t first; ///< First vertex not drawn
+	static std::size_t end; ///< Next vertex to write
+	static GLuint texture; ///< Of the pending quads, 0 if none
+	static bool sdf;
+	static std::uint64_t nDraws;
+};
+
+} // namespace fab
+
+#endif // !FABRICA_CLIENT_RENDERER_UIBATCH_HPP_
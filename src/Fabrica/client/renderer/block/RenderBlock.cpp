@@ -14,14 +14,12 @@ RenderBlockFull::RenderBlockFull(std::map<ResourceLocation, Facing3> const& face
 	assert(!faces.empty() && "class RenderBlockFull: faces empty");
 }
 
-void RenderBlockFull::loadTextures(int size,
-                                   std::function<int (void*)> registry)
+void RenderBlockFull::loadTextures(std::function<int (ResourceLocation const&)>
+                                   registry)
 {
 	for (auto const& face: faces)
 	{
-		uint8_t tex[size * size * 4]; // 4 channels, RGBA
-		loadTexturePNG(tex, face.first, size, size);
-		int chartId = registry(tex);
+		int chartId = registry(face.first);
 		for (auto facing: FACING3_VALUES)
 		{
 			if (!isEmpty(facing & face.second))
@@ -66,12 +64,10 @@ RenderBlockUniform::RenderBlockUniform(ResourceLocation const& rl):
 	rl(rl)
 {
 }
-void RenderBlockUniform::loadTextures(int size,
-                                      std::function<int (void*)> registry)
+void RenderBlockUniform::loadTextures(std::function<int (ResourceLocation const&)>
+                                      registry)
 {
-	uint8_t tex[size * size * 4]; // 4 channels, RGBA
-	loadTexturePNG(tex, rl, size, size);
-	chartId = registry(tex);
+	chartId = registry(rl);
 }
 void RenderBlockUniform::loadGeometry(TextureAtlas const& atlas,
                                       GeometryLoader& loader) const
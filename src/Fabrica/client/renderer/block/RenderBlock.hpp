@@ -22,13 +22,14 @@ public:
 	virtual ~RenderBlock() = default;
 
 	/**
-	 * @brief Called upon initialisation. Loads the texture using the given
-	 *  registry function.
-	 * @param[in] size Width/Height of each texture. At the moment = 16.
-	 * @param registry A function, accepting a size x size array of RGBA
-	 *  (1 byte/channel, 4 channels)
+	 * @brief Called upon initialisation. Registers the textures using the
+	 *  given registry function.
+	 * @param registry A function, accepting the location of a PNG texture
+	 *  and returning the id of its chart. The texture is decoded and loaded
+	 *  later, together with the others.
 	 */
-	virtual void loadTextures(int size, std::function<int (void*)> registry) = 0;
+	virtual void
+	loadTextures(std::function<int (ResourceLocation const&)> registry) = 0;
 
 	/**
 	 * @brief Loads the geometry (for Items and other effects)
@@ -52,7 +53,8 @@ public:
 	RenderBlockFull(); ///< Default constructor.
 	RenderBlockFull(std::map<ResourceLocation, Facing3> const&);
 
-	virtual void loadTextures(int size, std::function<int (void*)> registry) override final;
+	virtual void loadTextures(std::function<int (ResourceLocation const&)>
+	                          registry) override final;
 
 	virtual void loadGeometry(TextureAtlas const& atlas,
 	                          GeometryLoader&) const override final;
@@ -75,7 +77,8 @@ public:
 	RenderBlockUniform(); ///< Default constructor.
 	RenderBlockUniform(ResourceLocation const&);
 
-	virtual void loadTextures(int size, std::function<int (void*)> registry) override final;
+	virtual void loadTextures(std::function<int (ResourceLocation const&)>
+	                          registry) override final;
 
 	virtual void loadGeometry(TextureAtlas const& atlas,
 	                          GeometryLoader&) const override final;
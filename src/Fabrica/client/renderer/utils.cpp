@@ -1,7 +1,12 @@
 #include "utils.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <vector>
 
 /**
  * Defined to mamke PNG io work
@@ -13,10 +18,160 @@
 #include <boost/gil/extension/io/png_io.hpp>
 
 #include "../../common/ModuleLoader.hpp"
+#include "../../util/file.hpp"
 
 namespace fab
 {
 
+namespace
+{
+
+boost::filesystem::path programCache;
+
+char const magicProgram[4] = {'F', 'A', 'B', 'P'};
+std::uint32_t const versionProgram = 1;
+
+struct ProgramHeader
+{
+	char magic[4];
+	std::uint32_t version;
+	std::uint64_t key;
+	std::uint32_t format; ///< Binary format of the driver
+	std::uint32_t length; ///< Of the binary
+};
+
+/**
+ * Hashes a null terminated string, including the terminator
+ */
+void hash(std::uint64_t& h, char const* str) noexcept
+{
+	if (!str) str = "";
+	hashFNV(h, str, std::strlen(str) + 1);
+}
+/**
+ * @brief Key of a program in the cache. Binaries are only valid for the
+ *  driver that produced them.
+ */
+std::uint64_t programKey(char const sourceVert[], char const sourceFrag[])
+{
+	std::uint64_t h = fnvBasis;
+	hash(h, sourceVert);
+	hash(h, sourceFrag);
+	hash(h, (char const*) glGetString(GL_VENDOR));
+	hash(h, (char const*) glGetString(GL_RENDERER));
+	hash(h, (char const*) glGetString(GL_VERSION));
+	return h;
+}
+boost::filesystem::path programFile(std::uint64_t key)
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long) key);
+	return programCache / name;
+}
+
+/**
+ * @brief Creates the program from its binary in the cache.
+ * @return False if there is none or the driver rejects it.
+ */
+bool loadGLProgram(GLuint* const program, std::uint64_t key)
+{
+	boost::filesystem::path const p = programFile(key);
+	boost::system::error_code error;
+	std::uintmax_t const size = boost::filesystem::file_size(p, error);
+	std::ifstream file(p.string(), std::ios::binary);
+	if (error || !file) return false;
+
+	ProgramHeader h;
+	if (!file.read(reinterpret_cast<char*>(&h), sizeof(h)) ||
+	    std::memcmp(h.magic, magicProgram, 4) != 0 ||
+	    h.version != versionProgram || h.key != key ||
+	    h.length != size - sizeof(h))
+		return false;
+	std::vector<char> binary(h.length);
+	if (!file.read(binary.data(), binary.size()))
+		return false;
+
+	*program = glCreateProgram();
+	glProgramBinary(*program, h.format, binary.data(), binary.size());
+	GLint result = GL_FALSE;
+	glGetProgramiv(*program, GL_LINK_STATUS, &result);
+	if (result != GL_TRUE)
+	{
+		// Usually a driver update
+		glDeleteProgram(*program);
+		return false;
+	}
+	return true;
+}
+/**
+ * @brief Writes the binary of a linked program to the cache. Failures only
+ *  cost a compilation on the next launch, so they are ignored.
+ */
+void storeGLProgram(GLuint program, std::uint64_t key)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	ProgramHeader h;
+	std::memcpy(h.magic, magicProgram, 4);
+	h.version = versionProgram;
+	h.key = key;
+	std::vector<char> binary(length);
+	GLenum format;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+	h.format = format;
+	h.length = length;
+
+	// Replaced whole, so that a crash never leaves half a binary
+	replaceFile(programFile(key),
+	            {{&h, sizeof(h)}, {binary.data(), (std::size_t) length}});
+}
+
+/**
+ * @brief Resamples the RGBA8 pixels of in into out. Each pixel of out
+ *  averages the block of pixels of in it covers, at least one, weighting the
+ *  colours by alpha so that transparent texels do not darken the edges.
+ */
+void resample(std::uint8_t* const out, int width, int height,
+              std::uint8_t const* const in, int inWidth, int inHeight)
+{
+	for (int y = 0; y < height; ++y)
+	{
+		int const y0 = y * inHeight / height;
+		int const y1 = std::max(y0 + 1, (y + 1) * inHeight / height);
+		for (int x = 0; x < width; ++x)
+		{
+			int const x0 = x * inWidth / width;
+			int const x1 = std::max(x0 + 1, (x + 1) * inWidth / width);
+
+			std::uint64_t sum[4] = {};
+			for (int j = y0; j < y1; ++j)
+				for (int i = x0; i < x1; ++i)
+				{
+					std::uint8_t const* p = in + (j * inWidth + i) * 4;
+					sum[0] += p[0] * p[3];
+					sum[1] += p[1] * p[3];
+					sum[2] += p[2] * p[3];
+					sum[3] += p[3];
+				}
+
+			std::uint8_t* q = out + (y * width + x) * 4;
+			int const n = (x1 - x0) * (y1 - y0);
+			for (int c = 0; c < 3; ++c)
+				q[c] = sum[3] ? (sum[c] + sum[3] / 2) / sum[3] : 0;
+			q[3] = (sum[3] + n / 2) / n;
+		}
+	}
+}
+
+} // namespace
+
+void setGLProgramCache(boost::filesystem::path const& folder)
+{
+	programCache = folder;
+}
+
 bool registerGLShader(
   GLuint* const shader,
   char const source[],
@@ -49,6 +204,15 @@ bool registerGLProgram(GLuint* const program,
                        char const sourceVert[],
                        char const sourceFrag[])
 {
+	// Binaries are only kept for drivers that can produce them.
+	GLint nFormats = 0;
+	if (!programCache.empty())
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nFormats);
+	std::uint64_t const key =
+	  nFormats > 0 ? programKey(sourceVert, sourceFrag) : 0;
+	if (nFormats > 0 && loadGLProgram(program, key))
+		return true;
+
 	GLuint shaderVert, shaderFrag;
 
 	// Compile the shaders
@@ -71,6 +235,9 @@ bool registerGLProgram(GLuint* const program,
 	*program = glCreateProgram();
 	glAttachShader(*program, shaderVert);
 	glAttachShader(*program, shaderFrag);
+	if (nFormats > 0)
+		glProgramParameteri(*program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+		                    GL_TRUE);
 	glLinkProgram(*program);
 
 	// If error occurs, return false
@@ -93,6 +260,8 @@ bool registerGLProgram(GLuint* const program,
 	glDeleteShader(shaderVert);
 	glDeleteShader(shaderFrag);
 
+	if (nFormats > 0)
+		storeGLProgram(*program, key);
 	return true;
 }
 GLuint generateQuadElementIndices(GLuint* buffer, std::size_t nQuads)
@@ -194,6 +363,21 @@ void loadTexture16PNG(std::uint8_t* const out,
 	}
 }
 
+bool readTextureSizePNG(ResourceLocation const& rl, int* width, int* height)
+{
+	std::string resolve = ModuleLoader::instance().resolveLocation(rl).string();
+	try
+	{
+		auto const dimensions = boost::gil::png_read_dimensions(resolve);
+		*width = dimensions.x;
+		*height = dimensions.y;
+		return true;
+	}
+	catch (std::ios_base::failure&)
+	{
+		return false;
+	}
+}
 void loadTexturePNG(std::uint8_t* const out,
                     ResourceLocation const& rl,
                     int width, int height)
@@ -212,14 +396,19 @@ void loadTexturePNG(std::uint8_t* const out,
 				"client/renderer/utils.cpp: "
 				"Must be RGBA_8 format");
 
-		boost::gil::copy_pixels(view,
-		                        boost::gil::interleaved_view(
-		                          view.width(),
-		                          view.height(),
-		                          (Pixel*) out,
-		                          view.width() * sizeof(Pixel)
-		                        )
-		                       );
+		if (view.width() == width && view.height() == height)
+			boost::gil::copy_pixels(view,
+			                        boost::gil::interleaved_view(
+			                          width,
+			                          height,
+			                          (Pixel*) out,
+			                          width * sizeof(Pixel)
+			                        )
+			                       );
+		else
+			resample(out, width, height,
+			         (std::uint8_t const*) &view(0, 0),
+			         view.width(), view.height());
 	}
 	catch (std::ios_base::failure& e)
 	{
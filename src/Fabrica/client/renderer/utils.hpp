@@ -2,6 +2,7 @@
 #define FABRICA_CLIENT_RENDERER_UTILS_HPP_
 
 #include <GL/glew.h>
+#include <boost/filesystem.hpp>
 
 #include "../../util/ResourceLocation.hpp"
 
@@ -53,8 +54,21 @@ bool registerGLShader(
   GLuint* const shader,
   char const source[],
   GLenum const type);
+/**
+ * @brief Sets the folder where linked programs are kept.
+ *
+ * {@code registerGLProgram} then loads programs from their binaries in this
+ * folder, keyed on their sources and on the vendor, renderer and version of
+ * the driver, and stores the binaries of those it compiles. Without a folder
+ * (the default, or an empty path) programs are always compiled.
+ */
+void setGLProgramCache(boost::filesystem::path const& folder);
 /**
  * @brief Register a GL shader program.
+ *
+ * Loaded from the program cache if it holds a binary of the same sources for
+ * this driver. Compiled otherwise, including when the binary is rejected.
+ *
  * @param[out] program Non-null. Filled with program if successful.
  * @param[in] sourceVert Source of the vertex shader
  * @param[in] sourceFrag Source of the fragment shader
@@ -75,22 +89,27 @@ bool registerGLProgram(GLuint* const program,
  */
 GLuint generateQuadElementIndices(GLuint* buffer, std::size_t nQuads);
 
+/**
+ * @brief Reads the dimensions of a PNG texture without decoding it.
+ * @return False if the texture is missing.
+ */
+bool readTextureSizePNG(ResourceLocation const& rl, int* width, int* height);
 /**
  * @brief Loads a RGBA8 PNG texture to the array out.
- * @warning Does NOT resize the texture if it doesn't match the dimensions
- *	width x height. 
- * @param[out] out Array that will store the texture.
- *  This routine is not responsible for allocations.
  *
- *  If the texture is missing, the default width x height texture will be
- *  loaded instead.
+ * A texture of other dimensions is resampled to width x height: each pixel
+ * averages (weighted by alpha) the texels it covers, so that larger textures
+ * are downscaled with a box filter. Smaller ones are enlarged without
+ * filtering.
+ *
+ * If the texture is missing, the default width x height texture will be
+ * loaded instead.
  *
  * @param[out] out Pixels will be filled here. This routine is not responsible
  *	for allocations and the size of out must be able to hold all the pixels.
  * @param[in] rl Location of file
- * @param[in] width Default width
- * @param[in] height Default height
- * TODO: Allow resizing. (See boost GIL documentation)
+ * @param[in] width Width of out
+ * @param[in] height Height of out
  */
 void loadTexturePNG(std::uint8_t* const out,
                     ResourceLocation const& rl,
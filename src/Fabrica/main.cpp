@@ -14,6 +14,9 @@
 	#include "client/Window.hpp"
 	#include "client/Client.hpp"
 	#include "client/ClientConfig.hpp"
+	#include "client/renderer/utils.hpp"
+	#include "server/LogicRegistry.hpp"
+	#include "world/Universe.hpp"
 #endif
 
 #ifndef NDEBUG
@@ -173,6 +176,13 @@ int main(int argc, char* argv[])
 	ClientConfig clientConfig(pConfigs / "client.txt");
 	clientConfig.read();
 
+	boost::filesystem::path pCache = pBase / "cache";
+	bool const hasCache = ensureFolderExists(pCache);
+	if (hasCache && ensureFolderExists(pCache / "shaders"))
+		setGLProgramCache(pCache / "shaders");
+	else
+		loggerInit.warn("Unable to create cache. Shaders will not be cached.");
+
 	{
 		std::string error = Window::initAll(
 		                      clientConfig.windowWidth,
@@ -190,12 +200,30 @@ int main(int argc, char* argv[])
 
 	Client client(&clientConfig);
 	loggerInit("Loading configuration file");
-	client.reloadRenderers();
+	if (hasCache)
+		client.reloadRenderers(pCache / "blocks.atlas");
+	else
+	{
+		loggerInit.warn("Unable to create cache. Textures will not be"
+		                " cached.");
+		client.reloadRenderers();
+	}
 
+	Universe universe(pBase / "saves" / "default",
+	                  LogicRegistry::getBlocks());
 	World defaultWorld;
+	if (universe.open())
+		universe.attach(defaultWorld);
+	else
+		loggerInit.warn("Unable to open save. The world will not be saved.");
+	defaultWorld.loadSpawn();
 	client.loadWorld(&defaultWorld);
 	client.execDraw();
 
+	loggerInit("Saving world");
+	defaultWorld.saveAll();
+	universe.flush();
+
 	loggerInit("Writing configuration file");
 	clientConfig.write();
 #endif
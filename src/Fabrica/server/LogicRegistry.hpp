@@ -42,6 +42,10 @@ public:
 	 *	The procedural name of this block.
 	 */
 	static void registerBlock(Block* block, std::string name);
+	/**
+	 * @brief Thread-safe copy of the registered blocks, by name.
+	 */
+	static std::map<std::string, Block*> getBlocks();
 
 private:
 	LogicRegistry();
@@ -64,6 +68,12 @@ inline void LogicRegistry::registerBlock(Block* block, std::string name)
 	instance().blocksMutex.unlock();
 }
 
+inline std::map<std::string, Block*> LogicRegistry::getBlocks()
+{
+	std::lock_guard<std::mutex> lock(instance().blocksMutex);
+	return instance().blocks;
+}
+
 inline LogicRegistry& LogicRegistry::instance()
 {
 	static LogicRegistry inst;
@@ -1,15 +1,21 @@
 #include "rendering.hpp"
 
+#include <cmath>
 #include <cstddef>
+#include <cstring>
+#include <iterator>
 
 #include "../../client/Camera.hpp"
 #include "../../client/DebugScreen.hpp"
 #include "../../client/RenderingRegistry.hpp"
 #include "../../client/Window.hpp"
 #include "../../client/WorldRenderer.hpp"
+#include "../../client/gui/GUIBase.hpp"
+#include "../../client/renderer/AtlasCache.hpp"
 #include "../../client/renderer/PerformanceMonitor.hpp"
 #include "../../client/renderer/Text.hpp"
 #include "../../client/renderer/TextureAtlas.hpp"
+#include "../../client/renderer/UIBatch.hpp"
 #include "../../client/renderer/utils.hpp"
 #include "../../client/renderer/block/RenderBlock.hpp"
 #include "../../common/fabrica.hpp"
@@ -814,8 +820,10 @@ bool test_cr6()
 	TextureAtlas atlas(16, 16, 4, 4, 2);
 	int chartId = 0;
 
-	rb.loadTextures(16, [&atlas, &chartId](void* array)
+	rb.loadTextures([&atlas, &chartId](ResourceLocation const& rl)
 	{
+		std::uint8_t array[16 * 16 * 4];
+		loadTexturePNG(array, rl, 16, 16);
 		atlas.loadChart(chartId, array);
 		return chartId++;
 	});
@@ -961,14 +969,343 @@ bool test_cr7()
 {
 	Window* window = &Window::instance();
 	World world;
-	std::mutex mutex;
 	InteractionFlags iflags;
 	TextureManager* tm = RenderingRegistry::initAll();
 
-	WorldRenderer wr(window, &world, &mutex, &iflags, tm);
+	WorldRenderer wr(window, &world, &iflags, tm);
 
 	delete tm;
 	return true;
 }
+bool test_cr8()
+{
+	TextureAtlas atlas(4, 4, 3); // One plane of 2x2 charts
+	if (atlas.getCapacity() != 4)
+		return false;
+
+	// Each chart is filled with its id.
+	int const nCharts = 11;
+	atlas.loadTexture();
+	for (int i = 0; i < nCharts; ++i)
+	{
+		std::uint8_t chart[4 * 4 * 4];
+		std::fill(chart, chart + sizeof(chart), (std::uint8_t) i);
+		atlas.loadChart(i, chart);
+	}
+	std::cout << "Capacity: " << atlas.getCapacity() << '\n';
+	if (atlas.getCapacity() < nCharts)
+		return false;
+
+	for (int i = 0; i < nCharts; ++i)
+	{
+		GLuint w;
+		float u0, u1, v0, v1;
+		atlas.chartUVW(&w, &u0, &u1, &v0, &v1, i);
+		// Planes are 8x8 pixels
+		std::uint8_t pixel[4];
+		atlas.loadTexture();
+		GLint texture;
+		glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &texture);
+		glGetTextureSubImage(texture, 0,
+		                     (int) (u0 * 8 + 0.5f), (int) (v0 * 8 + 0.5f), w,
+		                     1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+		                     sizeof(pixel), pixel);
+		if (pixel[0] != i)
+		{
+			std::cerr << "Chart " << i << " lost: " << (int) pixel[0] << '\n';
+			return false;
+		}
+	}
+	return true;
+}
+bool test_cr9()
+{
+	// Cells of 8x8 pixels: 4x4 charts in a gutter of 2
+	TextureAtlas atlas(4, 4, 4, 2);
+	std::cout << "Levels: " << atlas.getLevels() << '\n';
+	if (atlas.getLevels() != 3)
+		return false;
+
+	// Block charts have the full chain: 16, 8, 4, 2 and 1 pixels.
+	{
+		TextureManager tm(1);
+		if (tm.getTextureBlock().getLevels() != 5)
+			return false;
+	}
+
+	atlas.loadTexture();
+	for (int i = 0; i < 4; ++i)
+	{
+		std::uint8_t chart[4 * 4 * 4];
+		std::fill(chart, chart + sizeof(chart), (std::uint8_t) (i * 50));
+		atlas.loadChart(i, chart);
+	}
+
+	// On the last level, each cell is 2x2 pixels and must not have mixed
+	// with its neighbours.
+	GLint texture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D_ARRAY, &texture);
+	std::uint8_t level[4 * 4 * 4];
+	glGetTextureSubImage(texture, 2, 0, 0, 0, 4, 4, 1,
+	                     GL_RGBA, GL_UNSIGNED_BYTE, sizeof(level), level);
+	for (int y = 0; y < 4; ++y)
+		for (int x = 0; x < 4; ++x)
+		{
+			int const chart = (y / 2) * 2 + x / 2;
+			if (level[(y * 4 + x) * 4] != chart * 50)
+			{
+				std::cerr << "Chart " << chart << " bled: "
+				          << (int) level[(y * 4 + x) * 4] << '\n';
+				return false;
+			}
+		}
+	return true;
+}
+bool test_cr10()
+{
+	namespace bfs = boost::filesystem;
+	bfs::path const file = bfs::temp_directory_path() /
+	                       bfs::unique_path("fabrica-%%%%-%%%%.atlas");
+	ResourceLocation const dirt("fabrica", "dirt.png");
+	ResourceLocation const grass("fabrica", "grass_top.png");
+	std::vector<ResourceLocation const*> const textures{&dirt, &grass};
+	std::vector<std::uint8_t> pixels(2 * 4 * 4 * 4);
+	for (std::size_t i = 0; i < pixels.size(); ++i)
+		pixels[i] = i * 7;
+
+	std::uint64_t const key = AtlasCache::key(textures, 4);
+	bool result;
+	{
+		AtlasCache cache(file);
+		result = !cache.open(key, textures, 4) &&
+		         cache.write(key, textures, 4, pixels.data());
+	}
+	if (result)
+	{
+		AtlasCache cache(file);
+		result = cache.open(key, textures, 4) &&
+		         std::memcmp(cache.getPixels(), pixels.data(),
+		                     pixels.size()) == 0;
+		// Another order of the charts, or another size, misses.
+		std::vector<ResourceLocation const*> const swapped{&grass, &dirt};
+		result = result &&
+		         !cache.open(AtlasCache::key(swapped, 4), swapped, 4) &&
+		         !cache.open(key, swapped, 4) &&
+		         !cache.open(AtlasCache::key(textures, 8), textures, 8);
+	}
+	bfs::remove(file);
+	return result;
+}
+bool test_cr11()
+{
+	Font font;
+	ResourceLocation fontLocation("fabrica", "font/DejaVuSansMono.ttf");
+	auto fontPath = ModuleLoader::instance().resolveLocation(fontLocation);
+	if (!font.setFontFile(fontPath.c_str()) || !font.setFontSize(20))
+		return false;
+
+	// Space has no bitmap.
+	int const nAscii = font.getNCachedGlyphs();
+	std::cout << "ASCII glyphs: " << nAscii << '\n';
+	if (nAscii == 0 || nAscii >= 0x7F - 0x20)
+		return false;
+
+	GLuint w;
+	float u0, u1, v0, v1, ax, ay, sx, sy, mx, my;
+	font.getChar(&w, &u0, &u1, &v0, &v1, &ax, &ay, &sx, &sy, &mx, &my, 'A');
+	if (font.getNCachedGlyphs() != nAscii)
+		return false;
+	font.getChar(&w, &u0, &u1, &v0, &v1, &ax, &ay, &sx, &sy, &mx, &my, 0xE9);
+	if (font.getNCachedGlyphs() != nAscii + 1)
+		return false;
+
+	// Distance field glyphs are kept across sizes and scale with them.
+	font.setSDF(true);
+	if (font.isSDF() || !font.setFontSize(20) || !font.isSDF())
+		return false;
+	float const advance = font.getCharAdvX('A');
+	font.getChar(&w, &u0, &u1, &v0, &v1, &ax, &ay, &sx, &sy, &mx, &my, 0xE9);
+	int const nCached = font.getNCachedGlyphs();
+	if (!font.setFontSize(40)) return false;
+	return font.getNCachedGlyphs() == nCached &&
+	       std::abs(font.getCharAdvX('A') - 2 * advance) < 1e-3f;
+}
+bool test_cr12()
+{
+	UIBatch::flush();
+	std::uint64_t const nDraws = UIBatch::getNDraws();
+
+	std::vector<Text> texts(16, Text(&Font::defaultFont()));
+	for (std::size_t i = 0; i < texts.size(); ++i)
+	{
+		GUIBase::fillRect(0, 20 * i, 100, 20 * i + 18, 0x80000000);
+		texts[i].setContents(-1.f, 1.f - 0.1f * i, Text::TOP_LEFT,
+		                     "Line " + std::to_string(i));
+		texts[i].draw();
+	}
+	UIBatch::flush();
+	std::cout << "Draws: " << UIBatch::getNDraws() - nDraws << '\n';
+	return UIBatch::getNDraws() - nDraws == 1;
+}
+
+bool test_cr13()
+{
+	char const* const contents[] =
+	{
+		"FPS: 60.0\nCamera: [1.0, 2.0]",
+		"FPS: 59.5\nCamera: [1.0, 2.0]",
+		"FPS: 59.5\nCamera: [1.0, 22.0]\nMeshes: 4",
+		"FPS: 1\nCamera: [1.0, 22.0]",
+		"",
+		"FPS: 60.0",
+	};
+	Text::Align const aligns[] = {Text::TOP_LEFT, Text::BOT_RIGHT};
+
+	// Laid out like a text laid out from scratch
+	auto same = [](Text const& text, Text const& fresh)
+	{
+		auto const& v0 = text.getVertices();
+		auto const& v1 = fresh.getVertices();
+		if (v0.size() != v1.size())
+			return false;
+		for (std::size_t i = 0; i < v0.size(); ++i)
+			if (std::abs(v0[i].x - v1[i].x) > 1e-5f ||
+			    std::abs(v0[i].y - v1[i].y) > 1e-5f ||
+			    v0[i].u != v1[i].u || v0[i].v != v1[i].v ||
+			    v0[i].w != v1[i].w)
+				return false;
+		return true;
+	};
+
+	for (auto align: aligns)
+	{
+		Text text(&Font::defaultFont());
+		for (auto const* str: contents)
+		{
+			text.setContents(-1.f, 1.f, align, str);
+			Text fresh(&Font::defaultFont());
+			fresh.setContents(-1.f, 1.f, align, str);
+			if (!same(text, fresh))
+				return false;
+		}
+	}
+
+	// Evicting glyphs from a full font lays the text out again when drawn.
+	Font font;
+	ResourceLocation fontLocation("fabrica", "font/DejaVuSansMono.ttf");
+	auto fontPath = ModuleLoader::instance().resolveLocation(fontLocation);
+	if (!font.setFontFile(fontPath.c_str()) || !font.setFontSize(20))
+		return false;
+	Text text(&font);
+	text.setContents(-1.f, 1.f, Text::TOP_LEFT, contents[2]);
+	std::uint64_t const generation = font.getGeneration();
+	GLuint w;
+	float u0, u1, v0, v1, ax, ay, sx, sy, mx, my;
+	int const nCodes = 2 * FONT_MAX_PLANES * FONT_PLANE_SIZE;
+	for (int c = 0x100; c < 0x100 + nCodes; ++c)
+		font.getChar(&w, &u0, &u1, &v0, &v1, &ax, &ay, &sx, &sy, &mx, &my, c);
+	std::cout << "Generations: " << font.getGeneration() - generation << '\n';
+	if (font.getGeneration() == generation)
+		return false;
+
+	text.draw();
+	UIBatch::flush();
+	Text fresh(&font);
+	fresh.setContents(-1.f, 1.f, Text::TOP_LEFT, contents[2]);
+	return same(text, fresh);
+}
+
+bool test_cr14()
+{
+	namespace bfs = boost::filesystem;
+	GLint nFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &nFormats);
+	std::cout << "Binary formats: " << nFormats << '\n';
+
+	char const sourceVert[] =
+	  "#version 330 core\n"
+	  "layout(location = 0) in vec2 position;"
+	  "void main()"
+	  "{"
+	  "gl_Position = vec4(position, 0, 1);"
+	  "}";
+	char const sourceFrag[] =
+	  "#version 330 core\n"
+	  "out vec4 color;"
+	  "void main()"
+	  "{"
+	  "color = vec4(1, 0, 0, 1);"
+	  "}";
+
+	bfs::path const folder = bfs::temp_directory_path() /
+	                         bfs::unique_path("fabrica-%%%%-%%%%");
+	bfs::create_directory(folder);
+	setGLProgramCache(folder);
+
+	// Linked, then loaded, then compiled over a corrupt binary
+	bool result = true;
+	for (int i = 0; i < 3 && result; ++i)
+	{
+		if (i == 2)
+			for (bfs::directory_iterator it(folder), end; it != end; ++it)
+				bfs::resize_file(it->path(), bfs::file_size(it->path()) - 1);
+
+		GLuint program;
+		GLint status = GL_FALSE;
+		result = registerGLProgram(&program, sourceVert, sourceFrag);
+		if (result)
+		{
+			glGetProgramiv(program, GL_LINK_STATUS, &status);
+			glDeleteProgram(program);
+		}
+		std::size_t nFiles = std::distance(bfs::directory_iterator(folder),
+		                                   bfs::directory_iterator());
+		result = result && status == GL_TRUE &&
+		         nFiles == (nFormats > 0 ? 1u : 0u);
+	}
+
+	setGLProgramCache({});
+	bfs::remove_all(folder);
+	return result;
+}
+
+bool test_cr15()
+{
+	int const n = 100;
+	std::size_t const all = TextureAtlas::footprint(256, 256, n, 128);
+	std::size_t const half = TextureAtlas::footprint(32, 32, n, 16);
+	std::cout << "Footprints: " << all << ", " << half << '\n';
+	// Planes of 16 x 16 cells, twice the charts wide
+	int const big = 1 << 16;
+	if (TextureManager::blockSizeFor(n, 64, all, big) != 64 ||
+	    TextureManager::blockSizeFor(n, 1024, all, big) != 256 ||
+	    TextureManager::blockSizeFor(n, 1024, all, 4096) != 128 ||
+	    TextureManager::blockSizeFor(n, 1024, all, 4095) != 64 ||
+	    TextureManager::blockSizeFor(n, 8, all, big) != 16 ||
+	    TextureManager::blockSizeFor(n, 64, half, big) != 32 ||
+	    TextureManager::blockSizeFor(n, 64, half - 1, big) != 16 ||
+	    TextureManager::blockSizeFor(n, 64, 0, big) != 16)
+		return false;
+
+	// Each downscaled pixel averages 2x2 texels of the original.
+	ResourceLocation rl("fabrica", "dirt.png");
+	std::uint8_t full[16 * 16 * 4];
+	std::uint8_t small[8 * 8 * 4];
+	loadTexturePNG(full, rl, 16, 16);
+	loadTexturePNG(small, rl, 8, 8);
+	for (int y = 0; y < 8; ++y)
+		for (int x = 0; x < 8; ++x)
+			for (int c = 0; c < 4; ++c)
+			{
+				int sum = 0;
+				for (int j = 0; j < 2; ++j)
+					for (int i = 0; i < 2; ++i)
+						sum += full[((2 * y + j) * 16 + 2 * x + i) * 4 + c];
+				// Opaque, so the weights are even.
+				if (std::abs(sum / 4 - small[(y * 8 + x) * 4 + c]) > 1)
+					return false;
+			}
+	return true;
+}
 
 } // namespace fab
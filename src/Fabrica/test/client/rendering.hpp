@@ -60,6 +60,67 @@ bool test_cr6();
  *	The WorldRenderer class.
  */
 bool test_cr7();
+/**
+ * Test cr8:
+ *	Growing a {@code TextureAtlas}.
+ *
+ *	Objective: Charts loaded before the atlas grows keep their pixels.
+ */
+bool test_cr8();
+/**
+ * Test cr9:
+ *	Mipmaps of a padded {@code TextureAtlas}.
+ *
+ *	Objective: The smallest level of a chart holds the chart only. Block charts
+ *	have mipmaps down to 1 pixel.
+ */
+bool test_cr9();
+/**
+ * Test cr10:
+ *	The {@code AtlasCache} class.
+ *
+ *	Objective: Written charts are read back only for the same textures.
+ */
+bool test_cr10();
+/**
+ * Test cr11:
+ *	The glyph cache of {@code Font}.
+ *
+ *	Objective: Only ASCII glyphs are loaded in advance, others on first use.
+ *	Distance field glyphs are not rasterised again when the size changes.
+ */
+bool test_cr11();
+/**
+ * Test cr12:
+ *	The {@code UIBatch} class.
+ *
+ *	Objective: Rectangles and texts of one font take a single draw.
+ */
+bool test_cr12();
+/**
+ * Test cr13:
+ *	Updates of the contents of {@code Text}.
+ *
+ *	Objective: Changing some lines gives the same geometry as laying out the
+ *	whole text again.
+ */
+bool test_cr13();
+/**
+ * Test cr14:
+ *	The program binary cache of {@code registerGLProgram}.
+ *
+ *	Objective: A program is stored once linked, and a corrupt binary is
+ *	compiled again and replaced.
+ */
+bool test_cr14();
+/**
+ * Test cr15:
+ *	Sizing of the block charts.
+ *
+ *	Objective: The chart size follows the textures within the memory budget,
+ *	and textures are downscaled with a box filter.
+ */
+bool test_cr15();
 
 } // namespace fab
 
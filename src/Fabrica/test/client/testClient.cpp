@@ -40,6 +40,14 @@ bool testClient(std::string id)
 	ModuleLoader::instance().clientInit();
 
 	TEST_FUNC(cr7);
+	TEST_FUNC(cr8);
+	TEST_FUNC(cr9);
+	TEST_FUNC(cr10);
+	TEST_FUNC(cr11);
+	TEST_FUNC(cr12);
+	TEST_FUNC(cr13);
+	TEST_FUNC(cr14);
+	TEST_FUNC(cr15);
 
 	TEST_FUNC(ci1);
 
@@ -1,6 +1,10 @@
 #include "testUtil.hpp"
 
+#include <fstream>
+#include <iterator>
+
 #include "../testing.hpp"
+#include "../../util/file.hpp"
 #include "../../util/vector.hpp"
 
 namespace fab
@@ -27,9 +31,42 @@ bool test_u1()
 	return true;
 }
 
+bool test_u2()
+{
+	namespace bfs = boost::filesystem;
+	bfs::path const dir = bfs::temp_directory_path() /
+	                      bfs::unique_path("fabrica-%%%%-%%%%");
+	bfs::create_directory(dir);
+	bfs::path const file = dir / "file";
+	auto contents = [&file]()
+	{
+		std::ifstream in(file.string(), std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(in),
+		                   std::istreambuf_iterator<char>());
+	};
+
+	char const first[] = "first";
+	char const second[] = "second";
+	bool const result =
+	  replaceFile(file, {{first, 5}, {second, 6}}) &&
+	  contents() == "firstsecond" &&
+	  replaceFile(file, {{second, 6}}) &&
+	  contents() == "second" &&
+	  !bfs::exists(dir / "file.tmp") &&
+	  // A missing directory leaves nothing behind
+	  !replaceFile(dir / "missing" / "file", {{first, 5}});
+	bfs::remove_all(dir);
+
+	// Test vector of FNV-1a
+	std::uint64_t h = fnvBasis;
+	hashFNV(h, "a", 1);
+	return result && h == 0xaf63dc4c8601ec8cull;
+}
+
 bool testUtil(std::string id)
 {
 	TEST_FUNC(u1);
+	TEST_FUNC(u2);
 
 	TEST_FINAL;
 }
@@ -0,0 +1,1199 @@
+#include "testWorld.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+
+#include "../testing.hpp"
+#include "../../core/Fabrica.hpp"
+#include "../../world/DirtyChunks.hpp"
+#include "../../world/Universe.hpp"
+#include "../../world/chunk/ChunkCodec.hpp"
+#include "../../world/World.hpp"
+
+namespace fab
+{
+
+namespace
+{
+
+/**
+ * Hashes the blocks of the given chunk columns. Missing chunks hash to 0.
+ */
+std::uint64_t hashColumns(WorldIn& world, std::vector<Vector2i> const& columns)
+{
+	std::uint64_t h = 14695981039346656037ull; // FNV-1a
+	for (auto const& c: columns)
+		for (int y = 0; y < World::chunkYMax; ++y)
+		{
+			ChunkIn* chunk = world.getChunkO(Vector3i(c.x(), y, c.y()));
+			for (int i = 0; i < Chunk::size; ++i)
+				for (int j = 0; j < Chunk::size; ++j)
+					for (int k = 0; k < Chunk::size; ++k)
+					{
+						std::uintptr_t b = chunk ?
+						  (std::uintptr_t) chunk->getBlock(i, j, k) : 0;
+						h = (h ^ b) * 1099511628211ull;
+					}
+		}
+	return h;
+}
+/**
+ * Columns of the square [-radius, radius)^2 shifted by offset.
+ */
+std::vector<Vector2i> columnSquare(int radius, Vector2i const& offset)
+{
+	std::vector<Vector2i> columns;
+	for (int x = -radius; x < radius; ++x)
+		for (int z = -radius; z < radius; ++z)
+			columns.push_back(offset + Vector2i(x, z));
+	return columns;
+}
+
+/**
+ * Copies the light of the given chunk columns.
+ */
+std::vector<int> snapshotLight(WorldIn& world,
+                               std::vector<Vector2i> const& columns)
+{
+	std::vector<int> light;
+	for (auto const& c: columns)
+		for (int y = 0; y < World::chunkYMax; ++y)
+		{
+			ChunkIn* chunk = world.getChunkO(Vector3i(c.x(), y, c.y()));
+			for (int i = 0; i < Chunk::volume; ++i)
+				light.push_back(chunk->getSkyLight(i) << 4 |
+				                chunk->getBlockLight(i));
+		}
+	return light;
+}
+
+class BlockLamp final: public Block
+{
+public:
+	int getLightEmission() const noexcept override { return 15; }
+};
+
+} // namespace
+
+bool test_w1()
+{
+	// All noise kernels must agree bitwise
+	{
+		SimplexNoise noise(42);
+		std::mt19937 rng(0);
+		std::uniform_real_distribution<float> dist(-4096.f, 4096.f);
+		std::size_t const n = 4099; // Not a multiple of 8, tests the tail
+		std::vector<float> x(n), y(n), r0(n), r1(n), r2(n);
+		for (std::size_t i = 0; i < n; ++i)
+		{
+			x[i] = dist(rng);
+			y[i] = (i % 3) ? dist(rng) : std::floor(dist(rng));
+		}
+		noise.sample(x.data(), y.data(), r0.data(), n,
+		             SimplexNoise::KERNEL_SCALAR);
+		noise.sample(x.data(), y.data(), r1.data(), n,
+		             SimplexNoise::KERNEL_SSE2);
+		noise.sample(x.data(), y.data(), r2.data(), n,
+		             SimplexNoise::KERNEL_AVX2);
+		std::cout << "Best noise kernel: " << (int) SimplexNoise::bestKernel()
+		          << '\n';
+		if (std::memcmp(r0.data(), r1.data(), n * sizeof(float)) ||
+		    std::memcmp(r0.data(), r2.data(), n * sizeof(float)))
+		{
+			std::cerr << "Noise kernels disagree\n";
+			return false;
+		}
+		for (float v: r0)
+			if (v < -1.f || v > 1.f)
+			{
+				std::cerr << "Noise out of range: " << v << '\n';
+				return false;
+			}
+	}
+	// The generated terrain must not depend on the number of threads
+	{
+		auto const columns = columnSquare(4, Vector2i(0, 0));
+		World w1(7), w4(7), wOther(8);
+		w1.loadColumns(columns, 1);
+		w4.loadColumns(columns, 4);
+		wOther.loadColumns(columns, 2);
+		std::uint64_t const h1 = hashColumns(w1, columns);
+		std::uint64_t const h4 = hashColumns(w4, columns);
+		std::uint64_t const hOther = hashColumns(wOther, columns);
+		std::cout << "Hash (1 thread): " << h1 << '\n'
+		          << "Hash (4 threads): " << h4 << '\n'
+		          << "Hash (other seed): " << hOther << '\n';
+		if (h1 != h4 || h1 == hOther)
+			return false;
+	}
+	// Surface must lie within the world
+	{
+		World world;
+		world.loadSpawn();
+		int heights[Chunk::size * Chunk::size];
+		int const maxHeight = World::chunkYMax * Chunk::size;
+		world.getGenerator().heightmap(0, 0, heights, maxHeight);
+		for (int i = 0; i < Chunk::size * Chunk::size; ++i)
+		{
+			int const x = i / Chunk::size;
+			int const z = i % Chunk::size;
+			if (!world.getBlockO(Vector3i(x, heights[i] - 1, z)) ||
+			    !world.getBlockO(Vector3i(x, heights[i] - 1, z))->isOpaque() ||
+			    world.getBlockO(Vector3i(x, heights[i], z))->isOpaque())
+			{
+				std::cerr << "Surface mismatch at [" << x << ", " << z << "]\n";
+				return false;
+			}
+		}
+	}
+	return true;
+}
+bool test_w2()
+{
+	World world;
+	world.loadSpawn();
+	std::size_t const columnBytes = sizeof(ChunkColumn);
+	world.loadColumns(columnSquare(2, Vector2i(0, 0))); // 16 columns
+
+	ResidencyStats stats = world.getResidencyStats();
+	std::cout << "Columns: " << stats.nColumns << ", Bytes: " << stats.bytes
+	          << ", Hits: " << stats.hits << ", Misses: " << stats.misses
+	          << '\n';
+	if (stats.nColumns != 16 ||
+	    stats.bytes < 16 * columnBytes ||
+	    stats.bytes > 16 * columnBytes + columnBytes / 2 ||
+	    stats.misses != stats.nColumns ||
+	    stats.hits != 9) // Spawn columns
+		return false;
+
+	// Modify a chunk far from the centre; it must be saved before eviction.
+	Vector3i const pDirty(-2, 0, -2);
+	world.setBlock(Chunk::size * pDirty, &BlockNull::instance);
+	world.setMemoryBudget(4 * columnBytes);
+
+	// Without a saver the dirty column stays.
+	world.evict(Vector2i(0, 0), 1);
+	stats = world.getResidencyStats();
+	if (!world.getChunkO(pDirty) || !world.getChunkO(Vector3i(0, 0, 0)) ||
+	    stats.bytes > 4 * columnBytes)
+	{
+		std::cerr << "Eviction without saver failed\n";
+		return false;
+	}
+
+	int nSaved = 0;
+	world.setSaver([&](Vector3i const& p, ChunkIn& chunk)
+	{
+		nSaved += p == pDirty && chunk.isDirty();
+		return true;
+	});
+	// Only the column in range stays
+	world.setMemoryBudget(columnBytes + columnBytes / 2);
+	world.evict(Vector2i(0, 0), 1);
+	stats = world.getResidencyStats();
+	std::cout << "Evictions: " << stats.evictions << ", Saves: " << stats.saves
+	          << ", Bytes: " << stats.bytes << '\n';
+	if (world.getChunkO(pDirty) || nSaved != 1 || stats.saves != 1 ||
+	    stats.evictions != 16 - stats.nColumns ||
+	    stats.nColumns != 1)
+		return false;
+
+	// The most recently requested columns survive.
+	world.setMemoryBudget(16 * columnBytes);
+	world.loadColumns(columnSquare(2, Vector2i(0, 0)));
+	world.loadColumns({Vector2i(1, 1)});
+	world.setMemoryBudget(columnBytes + columnBytes / 2);
+	world.evict(Vector2i(100, 100), 1);
+	if (!world.getChunkO(Vector3i(1, 5, 1)) ||
+	    world.getResidencyStats().nColumns != 1)
+		return false;
+
+	// So do the columns used since, without counting hits.
+	world.setMemoryBudget(16 * columnBytes);
+	world.loadColumns(columnSquare(2, Vector2i(0, 0)));
+	std::uint64_t const hits = world.getResidencyStats().hits;
+	world.touchColumns(Vector2i(-2, -2), 1);
+	world.setMemoryBudget(columnBytes + columnBytes / 2);
+	world.evict(Vector2i(100, 100), 1);
+	return world.getChunkO(Vector3i(-2, 5, -2)) &&
+	       world.getResidencyStats().hits == hits;
+}
+bool test_w3()
+{
+	namespace bfs = boost::filesystem;
+	bfs::path const dir = bfs::temp_directory_path() /
+	                      bfs::unique_path("fabrica-%%%%-%%%%");
+	std::map<std::string, Block*> const blocks{{"grass", &Fabrica::blockGrass}};
+	std::vector<Vector2i> const columns{Vector2i(0, 0), Vector2i(40, -5)};
+
+	// The directory is removed on every exit.
+	auto run = [&]()
+	{
+		// Edits survive a save and reload, across two regions
+		std::uint64_t hSaved;
+		{
+			Universe universe(dir, blocks);
+			World world(3);
+			if (!universe.open()) return false;
+			universe.attach(world);
+			world.loadColumns(columns);
+			world.setBlock(Vector3i(1, 2, 3), &BlockNull::instance);
+			world.setBlock(Vector3i(640, 240, -80), &Fabrica::blockGrass);
+			hSaved = hashColumns(world, columns);
+			if (world.saveAll() != 2 || !universe.flush()) return false;
+		}
+		{
+			Universe universe(dir, blocks);
+			World world(3);
+			if (!universe.open()) return false;
+			universe.attach(world);
+			world.loadColumns(columns);
+			std::uint64_t const hLoaded = hashColumns(world, columns);
+			std::cout << "Hash (saved): " << hSaved << '\n'
+			          << "Hash (loaded): " << hLoaded << '\n';
+			if (hSaved != hLoaded ||
+			    world.getChunkO(Vector3i(0, 0, 0))->isDirty())
+				return false;
+		}
+
+		// A torn header falls back to the previous one
+		{
+			bfs::path const file = dir / "test.fr";
+			{
+				RegionFile rf(file, 1);
+				if (!rf.open() ||
+				    !rf.commit({{5, "first"}}) ||
+				    !rf.commit({{5, "second"}, {6, "other"}}))
+					return false;
+			}
+			// The second commit has generation 3 and is in header B
+			{
+				std::fstream f(file.string(),
+				               std::ios::in | std::ios::out | std::ios::binary);
+				std::size_t const headerSize =
+				  (16 + 8 + RegionFile::width * RegionFile::width * 8 +
+				   RegionFile::sectorSize - 1) / RegionFile::sectorSize *
+				  RegionFile::sectorSize;
+				f.seekp(headerSize + 24 + 5 * 8);
+				f.write("\xFF\xFF", 2);
+			}
+			RegionFile rf(file, 1);
+			if (!rf.open()) return false;
+			auto r = rf.read(5);
+			if (std::string(r.first, r.second) != "first" || rf.read(6).first)
+			{
+				std::cerr << "Torn header not detected\n";
+				return false;
+			}
+
+			// Rewriting a slot many times calls for compaction
+			for (int i = 0; i < 300; ++i)
+				if (!rf.commit({{5, std::string(100, 'a' + i % 26)}}) ||
+				    (rf.shouldCompact() && !rf.compact()))
+					return false;
+			r = rf.read(5);
+			std::cout << "Sectors: " << rf.getFileSectors() << ", Live: "
+			          << rf.getLiveSectors() << '\n';
+			if (std::string(r.first, r.second) !=
+			    std::string(100, 'a' + 299 % 26) ||
+			    rf.getFileSectors() > 300)
+				return false;
+		}
+		return true;
+	};
+	bool const result = run();
+	bfs::remove_all(dir);
+	return result;
+}
+bool test_w4()
+{
+	// Enough distinct blocks to overflow the palette
+	std::vector<Block> extra(ChunkCodec::paletteMax + 1);
+	std::vector<Block*> blocks{&BlockNull::instance, &Fabrica::blockGrass};
+	for (auto& b: extra)
+		blocks.push_back(&b);
+	ChunkCodec codec;
+	codec.setBlocks(blocks);
+
+	std::mt19937 rng(0);
+	auto roundtrip = [&codec](ChunkIn& chunk, char const* name)
+	{
+		std::string data;
+		codec.encode(chunk, data);
+		Chunk decoded;
+		bool same = codec.decode(data.data(), data.size(), decoded);
+		for (int i = 0; i < Chunk::size; ++i)
+			for (int j = 0; j < Chunk::size; ++j)
+				for (int k = 0; k < Chunk::size; ++k)
+					same = same &&
+					       chunk.getBlock(i, j, k) == decoded.getBlock(i, j, k);
+		std::cout << name << ": " << data.size() << " bytes, format "
+		          << (int) data[0] << '\n';
+		if (!same)
+			std::cerr << name << ": Roundtrip failed\n";
+
+		// Truncated data must be rejected
+		for (std::size_t n = 0; n < data.size(); n += 1 + data.size() / 64)
+			if (codec.decode(data.data(), n, decoded))
+			{
+				std::cerr << name << ": Truncated data accepted\n";
+				return false;
+			}
+		return same;
+	};
+
+	World world(5);
+	world.loadColumns({Vector2i(0, 0)});
+	Chunk random, varied, noisy;
+	std::uniform_int_distribution<std::size_t> few(0, 5), some(0, 199),
+	                                            many(0, blocks.size() - 1);
+	for (int i = 0; i < Chunk::size; ++i)
+		for (int j = 0; j < Chunk::size; ++j)
+			for (int k = 0; k < Chunk::size; ++k)
+			{
+				random.setBlock(i, j, k, blocks[few(rng)]);
+				varied.setBlock(i, j, k, blocks[some(rng)]);
+				noisy.setBlock(i, j, k, blocks[many(rng)]);
+			}
+
+	// Up to 256 distinct blocks are packed in 8 bits.
+	std::string data;
+	codec.encode(varied, data);
+	if (data[0] != ChunkCodec::FORMAT_PALETTE)
+	{
+		std::cerr << "200 blocks not paletted\n";
+		return false;
+	}
+	return roundtrip(Chunk::chunkNull(), "Empty") &&
+	       roundtrip(*world.getChunkO(Vector3i(0, 0, 0)), "Terrain") &&
+	       roundtrip(random, "Random (6 blocks)") &&
+	       roundtrip(varied, "Random (200 blocks)") &&
+	       roundtrip(noisy, "Random (259 blocks)");
+}
+bool test_w5()
+{
+	World world(11);
+	auto const columns = columnSquare(2, Vector2i(0, 0));
+	world.loadColumns(columns);
+	BlockLamp lamp;
+
+	auto sky = [&world](int x, int y, int z)
+	{
+		Vector3i const p(x, y, z);
+		return world.getChunkO(Vector3i(divide_floor(x, 16), y / 16,
+		                                divide_floor(z, 16)))
+		       ->getSkyLight(Chunk::cell(modulo_floor(x, 16), y % 16,
+		                                 modulo_floor(z, 16)));
+	};
+	auto block = [&world](int x, int y, int z)
+	{
+		return world.getChunkO(Vector3i(divide_floor(x, 16), y / 16,
+		                                divide_floor(z, 16)))
+		       ->getBlockLight(Chunk::cell(modulo_floor(x, 16), y % 16,
+		                                   modulo_floor(z, 16)));
+	};
+	if (sky(0, 255, 0) != 15 || sky(0, 0, 0) != 0)
+	{
+		std::cerr << "Initial sky light is wrong\n";
+		return false;
+	}
+
+	// Terrain is at least 2 blocks high, so a tunnel at y = 0 is enclosed. It
+	// crosses the chunk border at x = 16.
+	for (int x = 0; x <= 20; ++x)
+		world.setBlock(Vector3i(x, 0, 0), &BlockNull::instance);
+	world.setBlock(Vector3i(5, 0, 0), &lamp);
+	world.updateLight(2);
+	for (int x = 6; x <= 20; ++x)
+		if (block(x, 0, 0) != std::max(0, 15 - (x - 5)) || sky(x, 0, 0) != 0)
+		{
+			std::cerr << "Tunnel light is wrong at x = " << x << '\n';
+			return false;
+		}
+
+	// A shaft to the surface lets the sky in; closing it removes it.
+	int surface = 1;
+	while (world.getBlockO(Vector3i(20, surface, 0))->isOpaque()) ++surface;
+	for (int y = 1; y < surface; ++y)
+		world.setBlock(Vector3i(20, y, 0), &BlockNull::instance);
+	world.updateLight();
+	std::cout << "Shaft from " << surface << ": sky " << sky(20, 0, 0) << ", "
+	          << sky(18, 0, 0) << '\n';
+	if (sky(20, 0, 0) != 15 || sky(18, 0, 0) != 13)
+		return false;
+	world.setBlock(Vector3i(20, surface - 1, 0), &Fabrica::blockGrass);
+	world.setBlock(Vector3i(5, 0, 0), &BlockNull::instance);
+	world.updateLight(2);
+	if (sky(20, 0, 0) != 0 || block(10, 0, 0) != 0)
+	{
+		std::cerr << "Light not removed\n";
+		return false;
+	}
+
+	// Incremental updates must match a full recomputation
+	world.setBlock(Vector3i(3, 0, 0), &lamp);
+	world.setBlock(Vector3i(20, surface - 1, 0), &BlockNull::instance);
+	world.updateLight(2);
+	auto const incremental = snapshotLight(world, columns);
+	world.getLightEngine().lightColumns(columns);
+	world.updateLight(2);
+	if (incremental != snapshotLight(world, columns))
+	{
+		std::cerr << "Incremental light differs from full recomputation\n";
+		return false;
+	}
+	return true;
+}
+bool test_w6()
+{
+	World world(5);
+	world.loadColumns(columnSquare(1, Vector2i(0, 0))); // Blocks [-16, 16)
+	for (int x = -16; x < 16; ++x)
+		for (int y = 200; y < 205; ++y)
+			for (int z = -1; z <= 1; ++z)
+				world.setBlock(Vector3i(x, y, z), &BlockNull::instance);
+	world.setBlock(Vector3i(5, 202, 0), &Fabrica::blockGrass);
+
+	// Across the chunk border at x = 0
+	RayHit h = world.raycast(Ray{Vector3f(-8.5f, 202.5f, 0.5f),
+	                             Vector3f(2.f, 0.f, 0.f), 64.f});
+	if (!h.hit || h.position != Vector3i(5, 202, 0) ||
+	    h.face != Facing3::West || std::abs(h.distance - 13.5f) > 1e-4f ||
+	    h.block != &Fabrica::blockGrass)
+	{
+		std::cerr << "Wrong hit: " << h.hit << ' ' << h.position.transpose()
+		          << ", " << h.distance << '\n';
+		return false;
+	}
+	if (world.raycast(Ray{Vector3f(-8.5f, 202.5f, 0.5f),
+	                      Vector3f(1.f, 0.f, 0.f), 13.f}).hit)
+	{
+		std::cerr << "Hit beyond the maximum distance\n";
+		return false;
+	}
+	// Stops at the unloaded chunk at x = 16
+	if (world.raycast(Ray{Vector3f(-8.5f, 202.5f, -0.5f),
+	                      Vector3f(1.f, 0.f, 0.f), 64.f}).hit)
+	{
+		std::cerr << "Hit in an unloaded chunk\n";
+		return false;
+	}
+	// Downwards from above the world onto the surface
+	int surface = World::chunkYMax * Chunk::size - 1;
+	while (world.getBlockO(Vector3i(3, surface, 3)) == &BlockNull::instance)
+		--surface;
+	h = world.raycast(Ray{Vector3f(3.5f, 300.f, 3.5f),
+	                      Vector3f(0.f, -1.f, 0.f), 400.f});
+	if (!h.hit || h.position != Vector3i(3, surface, 3) ||
+	    h.face != Facing3::Up || std::abs(h.distance - (299 - surface)) > 1e-3f)
+	{
+		std::cerr << "Wrong surface hit: " << h.position.transpose() << '\n';
+		return false;
+	}
+
+	// Batched rays must match single rays, and hit the face they report.
+	std::mt19937 gen(6);
+	std::normal_distribution<float> normal;
+	std::vector<Ray> rays;
+	for (int i = 0; i < 1024; ++i)
+		rays.push_back(Ray{Vector3f(3.5f, surface + 2.5f, 3.5f),
+		                   Vector3f(normal(gen), normal(gen), normal(gen)),
+		                   40.f});
+	std::vector<RayHit> hits(rays.size());
+	world.raycast(rays.data(), hits.data(), rays.size(), 4);
+	int nHits = 0;
+	for (std::size_t i = 0; i < rays.size(); ++i)
+	{
+		RayHit const single = world.raycast(rays[i]);
+		if (single.hit != hits[i].hit ||
+		    single.position != hits[i].position ||
+		    single.face != hits[i].face)
+		{
+			std::cerr << "Batched ray " << i << " differs\n";
+			return false;
+		}
+		if (!single.hit) continue;
+		++nHits;
+		Vector3f const p = rays[i].origin +
+		                   rays[i].direction.normalized() * single.distance;
+		Vector3f const f = toFace(single.face).cast<float>();
+		Vector3f const centre = single.position.cast<float>() +
+		                        Vector3f(0.5f, 0.5f, 0.5f);
+		if (std::abs((p - centre).dot(f) - 0.5f) > 1e-3f ||
+		    (p - centre).cwiseAbs().maxCoeff() > 0.5f + 1e-3f)
+		{
+			std::cerr << "Ray " << i << " does not enter through its face\n";
+			return false;
+		}
+	}
+	std::cout << nHits << '/' << rays.size() << " rays hit\n";
+	return nHits > 0;
+}
+bool test_w7()
+{
+	World world(5);
+	world.loadColumns(columnSquare(1, Vector2i(0, 0))); // Blocks [-16, 16)
+	for (int x = -16; x < 16; ++x)
+		for (int y = 200; y < 210; ++y)
+			for (int z = -3; z <= 3; ++z)
+			{
+				Block* const b = x == 5 && y < 205 ?
+				  (Block*) &Fabrica::blockGrass : &BlockNull::instance;
+				world.setBlock(Vector3i(x, y, z), b);
+			}
+	auto box = [](float x, float y, float z)
+	{
+		return AABB{Vector3f(x - 0.3f, y, z - 0.3f),
+		            Vector3f(x + 0.3f, y + 1.8f, z + 0.3f)};
+	};
+
+	// Into the wall at x = 5, across the chunk border at x = 0
+	SweepHit h = world.sweep(Sweep{box(-1.f, 201.f, 0.f), Vector3f(10, 0, 0)});
+	if (!h.hit || h.face != Facing3::West || h.position.x() != 5 ||
+	    std::abs(h.time - 0.57f) > 1e-4f || h.block != &Fabrica::blockGrass)
+	{
+		std::cerr << "Wrong wall hit: " << h.hit << ' ' << h.time << ' '
+		          << h.position.transpose() << '\n';
+		return false;
+	}
+	// Along the wall, the blocked axis is dropped.
+	Vector3f moved = world.slide(box(-1.f, 201.f, 0.f), Vector3f(10, 0, 1));
+	if (std::abs(moved.x() - 5.7f) > 1e-3f || std::abs(moved.z() - 1.f) > 1e-4f)
+	{
+		std::cerr << "Wrong slide: " << moved.transpose() << '\n';
+		return false;
+	}
+	// Over the wall into the unloaded chunk at x = 16
+	h = world.sweep(Sweep{box(-1.f, 206.f, 0.f), Vector3f(40, 0, 0)});
+	if (!h.hit || h.block || h.position.x() != 16 ||
+	    std::abs(h.time - (16.f - -0.7f) / 40.f) > 1e-4f)
+	{
+		std::cerr << "Unloaded chunk not hit\n";
+		return false;
+	}
+	// Falling onto the surface
+	int surface = World::chunkYMax * Chunk::size - 1;
+	while (world.getBlockO(Vector3i(3, surface, 3)) == &BlockNull::instance)
+		--surface;
+	moved = world.slide(box(3.5f, surface + 5.f, 3.5f), Vector3f(0, -50, 0));
+	if (std::abs(moved.y() + 4.f) > 1e-3f)
+	{
+		std::cerr << "Wrong landing: " << moved.transpose() << '\n';
+		return false;
+	}
+
+	// Batched sweeps must match single sweeps, and stop at the face they
+	// report.
+	std::mt19937 gen(7);
+	std::uniform_real_distribution<float> offset(-12.f, 12.f);
+	std::vector<Sweep> sweeps;
+	for (int i = 0; i < 1024; ++i)
+		sweeps.push_back(Sweep{box(offset(gen), surface + offset(gen) / 4.f,
+		                           offset(gen)),
+		                       Vector3f(offset(gen), offset(gen), offset(gen))});
+	std::vector<SweepHit> hits(sweeps.size());
+	world.sweep(sweeps.data(), hits.data(), sweeps.size(), 4);
+	int nHits = 0;
+	for (std::size_t i = 0; i < sweeps.size(); ++i)
+	{
+		SweepHit const single = world.sweep(sweeps[i]);
+		if (single.hit != hits[i].hit || single.time != hits[i].time ||
+		    single.position != hits[i].position)
+		{
+			std::cerr << "Batched sweep " << i << " differs\n";
+			return false;
+		}
+		if (!single.hit || single.time == 0.f) continue;
+		++nHits;
+		Vector3i const normal = toFace(single.face);
+		int const a = normal.x() ? 0 : normal.y() ? 1 : 2;
+		Vector3f const step = sweeps[i].displacement * single.time;
+		float const face = normal[a] < 0 ?
+		                   sweeps[i].box.max[a] + step[a] :
+		                   sweeps[i].box.min[a] + step[a];
+		float const plane = single.position[a] + (normal[a] < 0 ? 0 : 1);
+		if (std::abs(face - plane) > 1e-3f)
+		{
+			std::cerr << "Sweep " << i << " does not stop at its face\n";
+			return false;
+		}
+	}
+	std::cout << nHits << '/' << sweeps.size() << " sweeps hit\n";
+	return nHits > 0;
+}
+bool test_w8()
+{
+	World world(3);
+	world.loadColumns(columnSquare(1, Vector2i(0, 0)));
+	BlockJournal& journal = world.getJournal();
+	int const early = journal.subscribe();
+
+	std::vector<Vector3i> const edits{Vector3i(-16, 0, 15), Vector3i(3, 255, -7),
+	                                  Vector3i(-1, 100, -1)};
+	std::vector<Block*> before, after;
+	for (auto const& p: edits)
+	{
+		before.push_back(world.getBlockO(p));
+		after.push_back(before.back() == &BlockNull::instance ?
+		                (Block*) &Fabrica::blockGrass : &BlockNull::instance);
+		world.setBlock(p, after.back());
+	}
+	world.setBlock(edits[0], after[0]); // No change
+	int const late = journal.subscribe();
+	world.setBlock(edits[0], before[0]);
+
+	std::vector<BlockChange> changes;
+	if (!journal.drain(early, changes) || changes.size() != 4)
+		return false;
+	for (std::size_t i = 0; i < edits.size(); ++i)
+		if (changes[i].position != edits[i] ||
+		    changes[i].before != before[i] ||
+		    changes[i].after != after[i])
+		{
+			std::cerr << "Wrong change " << i << ": "
+			          << changes[i].position.transpose() << '\n';
+			return false;
+		}
+	changes.clear();
+	if (!journal.drain(late, changes) || changes.size() != 1 ||
+	    changes[0].after != before[0])
+		return false;
+	changes.clear();
+	if (!journal.drain(early, changes) || !changes.empty())
+		return false;
+
+	// Loading and evicting a column record each of its sections.
+	world.loadColumns({Vector2i(5, 5)});
+	world.setMemoryBudget(0);
+	world.setSaver([](Vector3i const&, ChunkIn&) { return true; });
+	world.evict(Vector2i(0, 0), 2);
+	if (!journal.drain(early, changes) ||
+	    changes.size() != 2 * World::chunkYMax ||
+	    std::any_of(changes.begin(), changes.end(),
+	                [](BlockChange const& c)
+	                {
+		                return !c.chunk || c.position.x() != 5 ||
+		                       c.position.z() != 5;
+	                }))
+	{
+		std::cerr << "Loads and evictions not recorded\n";
+		return false;
+	}
+
+	// A subscriber that falls behind gets the newest changes and a warning.
+	BlockJournal small(8);
+	int const s = small.subscribe();
+	for (int i = 0; i < 20; ++i)
+		small.appendChunk(Vector3i(i, 0, 0));
+	changes.clear();
+	if (small.drain(s, changes) || changes.size() != 8 ||
+	    changes.front().position.x() != 12)
+	{
+		std::cerr << "Overflow not reported\n";
+		return false;
+	}
+	small.unsubscribe(s);
+	return small.subscribe() == s;
+}
+bool test_w9()
+{
+	auto chunkOf = [](Vector3i const& p)
+	{
+		return Vector3i(divide_floor(p.x(), Chunk::size),
+		                divide_floor(p.y(), Chunk::size),
+		                divide_floor(p.z(), Chunk::size));
+	};
+	auto sorted = [](std::vector<Vector3i> v)
+	{
+		std::sort(v.begin(), v.end(), [](Vector3i const& a, Vector3i const& b)
+		{
+			return std::lexicographical_compare(a.data(), a.data() + 3,
+			                                    b.data(), b.data() + 3);
+		});
+		return v;
+	};
+
+	// The marked chunks must be exactly those containing the block or one of
+	// its neighbours (face neighbours, or all 26 with diagonal meshes).
+	std::mt19937 gen(9);
+	std::uniform_int_distribution<int> coord(-40, 40);
+	for (bool diagonal: {false, true})
+		for (int i = 0; i < 2000; ++i)
+		{
+			Vector3i const p(coord(gen), coord(gen) + 40, coord(gen));
+			DirtyChunks dirty(diagonal);
+			dirty.markBlock(p);
+
+			DirtyChunks expected;
+			for (int x = -1; x <= 1; ++x)
+				for (int y = -1; y <= 1; ++y)
+					for (int z = -1; z <= 1; ++z)
+						if (diagonal ||
+						    std::abs(x) + std::abs(y) + std::abs(z) <= 1)
+							expected.markChunk(chunkOf(p + Vector3i(x, y, z)));
+			if (sorted(dirty.take()) != sorted(expected.take()))
+			{
+				std::cerr << "Wrong chunks for " << p.transpose()
+				          << (diagonal ? " (diagonal)\n" : "\n");
+				return false;
+			}
+		}
+
+	// Edits in one chunk coalesce, and invalid chunks are not marked.
+	DirtyChunks dirty;
+	for (int x = 1; x < 15; ++x)
+		for (int z = 1; z < 15; ++z)
+			dirty.markBlock(Vector3i(x, 7, z));
+	dirty.markBlock(Vector3i(3, 0, 3)); // Chunk below is invalid
+	if (dirty.size() != 1)
+		return false;
+	dirty.take();
+	return dirty.empty();
+}
+bool test_w10()
+{
+	World world(10);
+	world.loadColumns(columnSquare(2, Vector2i(0, 0)));
+	WorldLocks& locks = world.getLocks();
+	Vector3i const a(0, 0, 0), b(-2, 0, -2);
+	if (WorldLocks::shardOf(a.x(), a.z()) == WorldLocks::shardOf(b.x(), b.z()))
+	{
+		std::cerr << "Regions share a shard\n";
+		return false;
+	}
+
+	// A writer does not block readers of other regions ...
+	{
+		WorldLocks::Region writer(locks, a, a, WorldLocks::WRITE);
+		std::uint64_t const contended = locks.stats().contended;
+		std::thread([&]
+		{
+			WorldLocks::Region reader(locks, b, b, WorldLocks::READ);
+		}).join();
+		if (locks.stats().contended != contended)
+		{
+			std::cerr << "Reader of another region waited\n";
+			return false;
+		}
+	}
+	// ... but blocks readers of its region, and the wait is counted.
+	{
+		LockStats const before = locks.stats();
+		std::thread reader;
+		{
+			WorldLocks::Region writer(locks, a, a, WorldLocks::WRITE);
+			reader = std::thread([&]
+			{
+				WorldLocks::Region r(locks, a, a, WorldLocks::READ);
+			});
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		}
+		reader.join();
+		LockStats const after = locks.stats();
+		std::cout << "Contended: " << after.contended - before.contended
+		          << ", Wait: " << (after.waitNs - before.waitNs) / 1e6 << " ms\n";
+		if (after.contended == before.contended ||
+		    after.waitNs - before.waitNs < 10000000)
+			return false;
+	}
+
+	// Concurrent readers and writers; every change must reach the journal.
+	std::uint64_t const sequence = world.getJournal().getSequence();
+	std::atomic<int> nChanges(0);
+	auto worker = [&](int seed)
+	{
+		std::mt19937 gen(seed);
+		std::uniform_int_distribution<int> coord(-32, 31);
+		for (int i = 0; i < 2000; ++i)
+		{
+			Vector3i const p(coord(gen), 64 + coord(gen), coord(gen));
+			Vector3i const chunk = World::chunkOf(p.cast<float>());
+			if (i % 500 == 499)
+			{
+				WorldLocks::Exclusive guard(locks);
+				world.updateLight();
+			}
+			else if (i % 3)
+			{
+				WorldLocks::Region guard(locks, chunk - Vector3i(1, 1, 1),
+				                         chunk + Vector3i(1, 1, 1),
+				                         WorldLocks::READ);
+				world.raycast(Ray{p.cast<float>(), Vector3f(1, -1, 1), 16.f});
+			}
+			else
+			{
+				WorldLocks::Region guard(locks, chunk - Vector3i(1, 1, 1),
+				                         chunk + Vector3i(1, 1, 1),
+				                         WorldLocks::WRITE);
+				Block* const before = world.getBlockO(p);
+				Block* const after = before == &BlockNull::instance ?
+				  (Block*) &Fabrica::blockGrass : &BlockNull::instance;
+				if (world.setBlock(p, after)) ++nChanges;
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; ++i)
+		threads.emplace_back(worker, i);
+	for (auto& t: threads)
+		t.join();
+	LockStats const stats = locks.stats();
+	std::cout << "Changes: " << nChanges << ", Locks: " << stats.acquisitions
+	          << ", Contended: " << stats.contended << '\n';
+	return world.getJournal().getSequence() - sequence == (unsigned) nChanges;
+}
+bool test_w11()
+{
+	auto const columns = columnSquare(2, Vector2i(0, 0)); // Blocks [-32, 32)
+	Block* const air = &BlockNull::instance;
+	Block* const grass = &Fabrica::blockGrass;
+	Vector3i const min(-20, 60, -5), max(21, 90, 3);
+	Vector3i const centre(3, 70, -2);
+	int const radius = 12;
+
+	// Block by block
+	World naive(11);
+	naive.loadColumns(columns);
+	std::size_t nFilled = 0, nReplaced = 0, nCounted = 0;
+	for (int x = min.x(); x <= max.x(); ++x)
+		for (int y = min.y(); y <= max.y(); ++y)
+			for (int z = min.z(); z <= max.z(); ++z)
+			{
+				Vector3i const p(x, y, z);
+				nFilled += naive.getBlockO(p) != air;
+				naive.setBlock(p, air);
+			}
+	for (int x = -radius; x <= radius; ++x)
+		for (int y = -radius; y <= radius; ++y)
+			for (int z = -radius; z <= radius; ++z)
+			{
+				Vector3i const p = centre + Vector3i(x, y, z);
+				if (x * x + y * y + z * z > radius * radius ||
+				    naive.getBlockO(p) != air)
+					continue;
+				naive.setBlock(p, grass);
+				++nReplaced;
+			}
+	for (int x = -32; x < 32; ++x)
+		for (int y = 0; y < 128; ++y)
+			for (int z = -32; z < 32; ++z)
+				nCounted += naive.getBlockO(Vector3i(x, y, z)) == grass;
+	naive.updateLight();
+
+	// In bulk, on 1 and 4 threads
+	for (unsigned int nThreads: {1u, 4u})
+	{
+		World world(11);
+		world.loadColumns(columns);
+		std::vector<std::uint32_t> revisions;
+		for (auto const& c: columns)
+			for (int y = 0; y < World::chunkYMax; ++y)
+				revisions.push_back(
+				  world.getChunkO(Vector3i(c.x(), y, c.y()))->getRevision());
+		int const journal = world.getJournal().subscribe();
+
+		if (world.fill(min, max, air, nThreads) != nFilled ||
+		    world.replace(centre, radius, air, grass, nThreads) != nReplaced ||
+		    world.count(Vector3i(-32, 0, -32), Vector3i(31, 127, 31), grass,
+		                nThreads) != nCounted)
+		{
+			std::cerr << "Wrong number of blocks on " << nThreads
+			          << " thread(s)\n";
+			return false;
+		}
+		if (hashColumns(world, columns) != hashColumns(naive, columns) ||
+		    snapshotLight(world, columns) != snapshotLight(naive, columns))
+		{
+			std::cerr << "Bulk edits differ on " << nThreads << " thread(s)\n";
+			return false;
+		}
+
+		// One revision and one journal entry per edit of each chunk
+		std::vector<BlockChange> changes;
+		world.getJournal().drain(journal, changes);
+		std::size_t i = 0, nRevisions = 0;
+		for (auto const& c: columns)
+			for (int y = 0; y < World::chunkYMax; ++y, ++i)
+			{
+				Vector3i const p(c.x(), y, c.y());
+				std::uint32_t const r = world.getChunkO(p)->getRevision();
+				std::size_t const n = std::count_if(changes.begin(),
+				                                    changes.end(),
+				  [&p](BlockChange const& c)
+				  {
+					  return c.chunk && c.position == p;
+				  });
+				if (r - revisions[i] != n || n > 2)
+				{
+					std::cerr << "Wrong revision of " << p.transpose() << '\n';
+					return false;
+				}
+				nRevisions += n;
+			}
+		std::cout << nThreads << " thread(s): " << nRevisions
+		          << " chunk revisions for " << nFilled + nReplaced
+		          << " blocks\n";
+		if (nRevisions != changes.size())
+			return false;
+	}
+	return true;
+}
+bool test_w12()
+{
+	auto const columns = columnSquare(2, Vector2i(0, 0)); // Blocks [-32, 32)
+	Block* const air = &BlockNull::instance;
+	Block* const grass = &Fabrica::blockGrass;
+	BlockLamp lamp;
+
+	World world(12);
+	world.loadColumns(columns);
+	std::mt19937 gen(12);
+	std::uniform_int_distribution<int> coord(-32, 31);
+	std::uniform_int_distribution<int> height(0, 255);
+	std::vector<Vector3i> lamps;
+	for (int i = 0; i < 40; ++i)
+	{
+		Vector3i const p(coord(gen), height(gen), coord(gen));
+		world.setBlock(p, &lamp);
+		lamps.push_back(p);
+	}
+	world.fill(Vector3i(-10, 80, -10), Vector3i(10, 100, 10), grass);
+	world.replace(Vector3i(0, 60, 0), 20, grass, air);
+
+	// The counts of every chunk must match its blocks, also after decoding.
+	ChunkCodec codec;
+	codec.setBlocks({air, grass, &lamp});
+	std::string encoded;
+	for (auto const& c: columns)
+		for (int y = 0; y < World::chunkYMax; ++y)
+		{
+			ChunkIn& chunk = *world.getChunkO(Vector3i(c.x(), y, c.y()));
+			Chunk decoded;
+			codec.encode(chunk, encoded);
+			codec.decode(encoded.data(), encoded.size(), decoded);
+			for (ChunkIn* ch: {&chunk, (ChunkIn*) &decoded})
+			{
+				int total = 0;
+				for (auto const& count: ch->getBlockCounts())
+				{
+					int n = 0;
+					for (int i = 0; i < Chunk::size; ++i)
+						for (int j = 0; j < Chunk::size; ++j)
+							n += ch->countRow(i, j, 0, Chunk::size, count.block);
+					if (count.count != n)
+					{
+						std::cerr << "Wrong count in chunk " << c.transpose()
+						          << ' ' << y << '\n';
+						return false;
+					}
+					total += n;
+				}
+				if (total != Chunk::volume)
+					return false;
+			}
+		}
+
+	// Nearest lamp, against a search of all blocks
+	int nFound = 0;
+	for (int i = 0; i < 200; ++i)
+	{
+		Vector3i const centre(coord(gen), height(gen), coord(gen));
+		int const radius = i % 2 ? 16 : 64;
+		std::int64_t best = -1;
+		for (auto const& p: lamps)
+		{
+			if (world.getBlockO(p) != &lamp) continue;
+			std::int64_t const d2 = (p - centre).cast<std::int64_t>()
+			                                    .squaredNorm();
+			if (d2 <= radius * radius && (best < 0 || d2 < best))
+				best = d2;
+		}
+		Vector3i found;
+		bool const hit = world.findNearest(centre, radius, &lamp, found);
+		if (hit != (best >= 0) ||
+		    (hit && (world.getBlockO(found) != &lamp ||
+		             (found - centre).cast<std::int64_t>().squaredNorm() !=
+		             best)))
+		{
+			std::cerr << "Wrong nearest lamp to " << centre.transpose() << '\n';
+			return false;
+		}
+		nFound += hit;
+	}
+	std::cout << nFound << "/200 searches found a lamp\n";
+	return nFound > 0;
+}
+bool test_w13()
+{
+	auto const columns = columnSquare(2, Vector2i(0, 0)); // Blocks [-32, 32)
+	Block* const air = &BlockNull::instance;
+	Block* const grass = &Fabrica::blockGrass;
+	BlockLamp lamp;
+
+	// Heights by scanning down from the top of the world
+	auto check = [&](WorldIn& world)
+	{
+		for (int x = -32; x < 32; ++x)
+			for (int z = -32; z < 32; ++z)
+				for (int k = 0; k < Heightmap::nKinds; ++k)
+				{
+					auto const kind = (Heightmap::Kind) k;
+					int y = World::chunkYMax * Chunk::size;
+					while (y > 0 &&
+					       !Heightmap::isTop(kind, world.getBlockO(
+					                                 Vector3i(x, y - 1, z))))
+						--y;
+					if (world.getHeight(x, z, kind) != y)
+					{
+						std::cerr << "Wrong height " << k << " at " << x << ' '
+						          << z << ": " << world.getHeight(x, z, kind)
+						          << " instead of " << y << '\n';
+						return false;
+					}
+				}
+		return true;
+	};
+
+	World world(13);
+	world.loadColumns(columns);
+	if (!check(world)) return false;
+
+	// Towers raised and dug out, lamps (not opaque) on top
+	std::mt19937 gen(13);
+	std::uniform_int_distribution<int> coord(-32, 31);
+	std::uniform_int_distribution<int> height(0, 255);
+	for (int i = 0; i < 4000; ++i)
+	{
+		Vector3i const p(coord(gen) / 4, height(gen), coord(gen) / 4);
+		Block* const b = i % 3 == 0 ? air : i % 3 == 1 ? grass : &lamp;
+		world.setBlock(p, b);
+	}
+	for (int y = 255; y >= 0; --y)
+		world.setBlock(Vector3i(1, y, 1), air);
+	if (!check(world)) return false;
+
+	// Bulk edits
+	world.fill(Vector3i(-20, 150, -20), Vector3i(-10, 200, 5), grass);
+	world.fill(Vector3i(-15, 0, -15), Vector3i(-12, 255, -12), air);
+	world.replace(Vector3i(10, 60, 10), 12, grass, &lamp);
+	if (!check(world)) return false;
+
+	// Evicted columns have no heightmap. Column [1, -2] is not modified, so
+	// it can be evicted without a saver.
+	world.setMemoryBudget(0);
+	world.evict(Vector2i(-1, -1), 1);
+	if (world.getHeightmap(Vector2i(1, -2)) ||
+	    world.getHeight(20, -20, Heightmap::SURFACE) != -1)
+	{
+		std::cerr << "Heightmap of an evicted column\n";
+		return false;
+	}
+	world.setMemoryBudget(ChunkResidency::defaultBudget);
+	world.loadColumns(columns);
+	return world.getHeightmap(Vector2i(1, -2)) && check(world);
+}
+bool test_wb1()
+{
+	namespace sc = std::chrono;
+
+	unsigned int const nCores = std::max(1u, std::thread::hardware_concurrency());
+	// Away from the spawn area, which is already loaded
+	auto const columns = columnSquare(8, Vector2i(64, 64));
+	std::size_t const nChunks = columns.size() * World::chunkYMax;
+
+	std::cout << "Generating " << columns.size() << " columns ("
+	          << nChunks << " chunks)\n";
+	for (unsigned int nThreads: {1u, nCores})
+	{
+		World world(1);
+		auto const begin = sc::high_resolution_clock::now();
+		world.loadColumns(columns, nThreads);
+		auto const end = sc::high_resolution_clock::now();
+
+		double const seconds =
+		  sc::duration_cast<sc::microseconds>(end - begin).count() * 1e-6;
+		double const rate = nChunks / seconds;
+		std::cout << nThreads << " thread(s): "
+		          << rate << " chunks/s, "
+		          << rate / nThreads << " chunks/s/core\n";
+		if (nCores == 1) break;
+	}
+	return true;
+}
+
+bool test_wb2()
+{
+	namespace sc = std::chrono;
+
+	ChunkCodec codec;
+	codec.setBlocks({&BlockNull::instance, &Fabrica::blockGrass});
+
+	World world(1);
+	auto const columns = columnSquare(4, Vector2i(0, 0));
+	world.loadColumns(columns);
+	std::vector<ChunkIn*> chunks;
+	for (auto const& c: columns)
+		for (int y = 0; y < World::chunkYMax; ++y)
+			chunks.push_back(world.getChunkO(Vector3i(c.x(), y, c.y())));
+
+	// Throughput is measured on the size of the raw encoding (2 bytes/block)
+	int const nRepeat = 20;
+	double const rawBytes = (double) nRepeat * chunks.size() *
+	                        Chunk::size * Chunk::size * Chunk::size * 2;
+	std::vector<std::string> encoded(chunks.size());
+	std::size_t encodedBytes = 0;
+
+	auto begin = sc::high_resolution_clock::now();
+	for (int r = 0; r < nRepeat; ++r)
+		for (std::size_t i = 0; i < chunks.size(); ++i)
+			codec.encode(*chunks[i], encoded[i]);
+	auto end = sc::high_resolution_clock::now();
+	double const secondsEncode =
+	  sc::duration_cast<sc::microseconds>(end - begin).count() * 1e-6;
+	for (auto const& e: encoded)
+		encodedBytes += e.size();
+
+	Chunk chunk;
+	begin = sc::high_resolution_clock::now();
+	for (int r = 0; r < nRepeat; ++r)
+		for (auto const& e: encoded)
+			if (!codec.decode(e.data(), e.size(), chunk))
+				return false;
+	end = sc::high_resolution_clock::now();
+	double const secondsDecode =
+	  sc::duration_cast<sc::microseconds>(end - begin).count() * 1e-6;
+
+	std::cout << chunks.size() << " chunks\n"
+	          << "Encode: " << rawBytes / secondsEncode / 1048576 << " MB/s\n"
+	          << "Decode: " << rawBytes / secondsDecode / 1048576 << " MB/s\n"
+	          << "Ratio: " << rawBytes / nRepeat / encodedBytes << '\n';
+	return true;
+}
+
+bool testWorld(std::string id)
+{
+	TEST_FUNC(w1);
+	TEST_FUNC(w2);
+	TEST_FUNC(w3);
+	TEST_FUNC(w4);
+	TEST_FUNC(w5);
+	TEST_FUNC(w6);
+	TEST_FUNC(w7);
+	TEST_FUNC(w8);
+	TEST_FUNC(w9);
+	TEST_FUNC(w10);
+	TEST_FUNC(w11);
+	TEST_FUNC(w12);
+	TEST_FUNC(w13);
+	TEST_FUNC(wb1);
+	TEST_FUNC(wb2);
+
+	TEST_FINAL;
+}
+
+} // namespace fab
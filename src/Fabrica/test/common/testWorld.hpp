@@ -0,0 +1,16 @@
+#ifndef FABRICA_TEST_COMMON_TESTWORLD_HPP_
+#define FABRICA_TEST_COMMON_TESTWORLD_HPP_
+
+#include <string>
+
+namespace fab
+{
+
+/**
+ * Executes world test [id].
+ */
+bool testWorld(std::string id);
+
+} // namespace fab
+
+#endif // !FABRICA_TEST_COMMON_TESTWORLD_HPP_
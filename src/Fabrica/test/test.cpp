@@ -4,6 +4,7 @@
 
 #include "common/testInit.hpp"
 #include "common/testUtil.hpp"
+#include "common/testWorld.hpp"
 #ifdef FABRICA_SERVER_STANDALONE
 #include "server/testServer.hpp"
 #else
@@ -20,6 +21,22 @@ std::map<std::string, std::string> testInfo()
 	info["0"] = "Always success";
 	info["i1"] = "Module Loader";
 	info["u1"] = "Chunk Loading Order";
+	info["u2"] = "File Replacement";
+	info["w1"] = "Terrain Generation";
+	info["w2"] = "Chunk Residency";
+	info["w3"] = "Region Files";
+	info["w4"] = "Chunk Codec";
+	info["w5"] = "Lighting";
+	info["w6"] = "Raycast";
+	info["w7"] = "Collision";
+	info["w8"] = "Block Journal";
+	info["w9"] = "Dirty Chunks";
+	info["w10"] = "World Locks";
+	info["w11"] = "Bulk Edit";
+	info["w12"] = "Block Index";
+	info["w13"] = "Heightmaps";
+	info["wb1"] = "Benchmark: Terrain Generation";
+	info["wb2"] = "Benchmark: Chunk Codec";
 #ifdef FABRICA_SERVER_STANDALONE
 	info["sc0"] = "Dummy";
 #else
@@ -29,6 +46,14 @@ std::map<std::string, std::string> testInfo()
 	info["cr4"] = "Displaying a texture";
 	info["cr5"] = "3D, class Camera, FPS calculation";
 	info["cr6"] = "RenderBlock";
+	info["cr8"] = "Texture Atlas Growth";
+	info["cr9"] = "Texture Atlas Mipmaps";
+	info["cr10"] = "Atlas Cache";
+	info["cr11"] = "Glyph Cache";
+	info["cr12"] = "UI Batch";
+	info["cr13"] = "Text Update";
+	info["cr14"] = "Program Cache";
+	info["cr15"] = "Texture Budget";
 	info["ci1"] = "Basic Initialisation (no graphics)";
 #endif
 	return info;
@@ -49,6 +74,8 @@ bool test(std::string id)
 		return testInit(id);
 	if (id.at(0) == 'u')
 		return testUtil(id);
+	if (id.at(0) == 'w')
+		return testWorld(id);
 #ifdef FABRICA_SERVER_STANDALONE
 	if (id.at(0) == 's')
 		return testServer(id);
@@ -18,6 +18,9 @@ std::map<std::string, std::string> testInfo();
  * Depends on the first character of id, executes different tests:
  *	c: Client
  *	s: Server
+ *	i: Initialisation
+ *	u: Utilities
+ *	w: World
  * 
  * The id with first character removed will be send to the
  * subordinating test functions.
@@ -0,0 +1,53 @@
+#include "file.hpp"
+
+#include <cerrno>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fab
+{
+
+namespace
+{
+
+bool writeAll(int fd, char const* data, std::size_t size)
+{
+	while (size > 0)
+	{
+		ssize_t n = ::write(fd, data, size);
+		if (n < 0 && errno == EINTR) continue;
+		if (n < 0) return false;
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+} // namespace
+
+bool replaceFile(boost::filesystem::path const& file,
+                 std::initializer_list<std::pair<void const*, std::size_t>>
+                   parts)
+{
+	boost::filesystem::path temporary = file;
+	temporary += ".tmp";
+	int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) return false;
+
+	bool result = true;
+	for (auto const& part: parts)
+		result = result &&
+		         writeAll(fd, static_cast<char const*>(part.first), part.second);
+	// Synced before the rename, which may otherwise reach the disk first
+	result = result && ::fsync(fd) == 0;
+	result = ::close(fd) == 0 && result;
+	if (result)
+		result = std::rename(temporary.c_str(), file.c_str()) == 0;
+	if (!result)
+		::unlink(temporary.c_str());
+	return result;
+}
+
+} // namespace fab
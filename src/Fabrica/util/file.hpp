@@ -0,0 +1,42 @@
+#ifndef FABRICA_UTIL_FILE_HPP_
+#define FABRICA_UTIL_FILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+#include <boost/filesystem.hpp>
+
+namespace fab
+{
+
+/// Initial value of a 64 bit FNV-1a hash
+constexpr std::uint64_t const fnvBasis = 14695981039346656037ull;
+
+/**
+ * @brief Continues the 64 bit FNV-1a hash h over size bytes of data.
+ */
+inline void hashFNV(std::uint64_t& h, void const* data,
+                    std::size_t size) noexcept
+{
+	auto const* p = static_cast<unsigned char const*>(data);
+	for (std::size_t i = 0; i < size; ++i)
+		h = (h ^ p[i]) * 1099511628211ull;
+}
+
+/**
+ * @brief Replaces a file by the concatenation of parts ({data, size} pairs).
+ *
+ * The parts are written to a temporary file beside it, which is synced and
+ * renamed over the file, so that a crash leaves either the old or the new
+ * contents. Uses POSIX file I/O.
+ * @return False on failure, in which case the file is unchanged.
+ */
+bool replaceFile(boost::filesystem::path const& file,
+                 std::initializer_list<std::pair<void const*, std::size_t>>
+                   parts);
+
+} // namespace fab
+
+#endif // !FABRICA_UTIL_FILE_HPP_
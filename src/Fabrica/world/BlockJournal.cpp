@@ -0,0 +1,100 @@
+#include "BlockJournal.hpp"
+
+#include <cassert>
+
+namespace fab
+{
+
+namespace
+{
+
+int const offsetXZ = 1 << 20; // Far beyond the world border
+
+inline std::int64_t pack(Vector3i const& p) noexcept
+{
+	return ((std::int64_t) (p.x() + offsetXZ) << 40) |
+	       ((std::int64_t) (p.z() + offsetXZ) << 16) |
+	       (std::int64_t) (p.y() & 0xFFFF);
+}
+inline Vector3i unpack(std::int64_t key) noexcept
+{
+	return Vector3i((int) (key >> 40) - offsetXZ,
+	                (int) (std::int16_t) (key & 0xFFFF),
+	                (int) ((key >> 16) & 0xFFFFFF) - offsetXZ);
+}
+
+} // namespace
+
+constexpr std::size_t const BlockJournal::defaultCapacity;
+constexpr std::uint64_t const BlockJournal::unsubscribed;
+
+BlockJournal::BlockJournal(std::size_t capacity):
+	entries(capacity),
+	head(0)
+{
+	assert(capacity && !(capacity & (capacity - 1)) &&
+	       "class BlockJournal: Capacity must be a power of 2");
+}
+
+void BlockJournal::append(Vector3i const& position,
+                          Block* before, Block* after) noexcept
+{
+	assert(before != after && "class BlockJournal: Block unchanged");
+	std::lock_guard<std::mutex> guard(mutex);
+	Entry& e = entries[head & (entries.size() - 1)];
+	e.position = pack(position);
+	e.before = before;
+	e.after = after;
+	++head;
+}
+void BlockJournal::appendChunk(Vector3i const& position) noexcept
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	Entry& e = entries[head & (entries.size() - 1)];
+	e.position = pack(position);
+	e.before = nullptr;
+	e.after = nullptr;
+	++head;
+}
+
+int BlockJournal::subscribe()
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	for (std::size_t i = 0; i < cursors.size(); ++i)
+		if (cursors[i] == unsubscribed)
+		{
+			cursors[i] = head;
+			return i;
+		}
+	cursors.push_back(head);
+	return cursors.size() - 1;
+}
+void BlockJournal::unsubscribe(int subscriber) noexcept
+{
+	assert(0 <= subscriber && subscriber < (int) cursors.size() &&
+	       "class BlockJournal: Invalid subscriber");
+	std::lock_guard<std::mutex> guard(mutex);
+	cursors[subscriber] = unsubscribed;
+}
+bool BlockJournal::drain(int subscriber, std::vector<BlockChange>& out)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	assert(0 <= subscriber && subscriber < (int) cursors.size() &&
+	       cursors[subscriber] != unsubscribed &&
+	       "class BlockJournal: Invalid subscriber");
+	std::uint64_t& cursor = cursors[subscriber];
+	bool const complete = head - cursor <= entries.size();
+	if (!complete)
+		cursor = head - entries.size();
+
+	out.reserve(out.size() + (head - cursor));
+	for (; cursor < head; ++cursor)
+	{
+		Entry const& e = entries[cursor & (entries.size() - 1)];
+		out.push_back(BlockChange{unpack(e.position), e.before, e.after,
+		                          e.before == e.after});
+	}
+	return complete;
+}
+
+} // namespace fab
@@ -0,0 +1,104 @@
+#ifndef FABRICA_WORLD_BLOCKJOURNAL_HPP_
+#define FABRICA_WORLD_BLOCKJOURNAL_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "../block/Block.hpp"
+#include "../util/vector.hpp"
+
+namespace fab
+{
+
+/**
+ * @brief A change of one block, or of any number of blocks of one chunk (by a
+ *  bulk edit). Chunk changes carry the chunk position and no blocks.
+ */
+struct BlockChange
+{
+	Vector3i position;
+	Block* before;
+	Block* after;
+	bool chunk; ///< Whether position is a chunk position
+};
+
+/**
+ * @brief Ring buffer of the block changes of a {@code World}, read by any
+ *  number of subscribers.
+ *
+ * Each subscriber has its own read position and drains the changes appended
+ * since its last drain, typically once per tick. If a subscriber falls behind
+ * by more than the capacity, the oldest changes are lost to it and
+ * {@code drain} reports the overflow, after which the subscriber must rescan
+ * whatever it derives from the world.
+ *
+ * Thread-safe.
+ */
+class BlockJournal final
+{
+public:
+	static constexpr std::size_t const defaultCapacity = 1 << 14;
+
+	/**
+	 * @param[in] capacity Number of changes kept. Must be a power of 2.
+	 */
+	BlockJournal(std::size_t capacity = defaultCapacity);
+
+	/**
+	 * @brief Records a block change. before and after must differ.
+	 */
+	void append(Vector3i const& position, Block* before, Block* after) noexcept;
+	/**
+	 * @brief Records changes to any number of blocks of a chunk.
+	 */
+	void appendChunk(Vector3i const& position) noexcept;
+
+	/**
+	 * @brief Registers a subscriber, which receives the changes appended from
+	 *  now on.
+	 * @return Id of the subscriber.
+	 */
+	int subscribe();
+	void unsubscribe(int subscriber) noexcept;
+	/**
+	 * @brief Appends the changes since the last drain of the subscriber to
+	 *  out, oldest first.
+	 * @return False if changes were lost since the last drain. The changes
+	 *  still in the buffer are appended anyway.
+	 */
+	bool drain(int subscriber, std::vector<BlockChange>& out);
+
+	/**
+	 * @brief Number of changes ever appended.
+	 */
+	std::uint64_t getSequence() const
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		return head;
+	}
+
+private:
+	/**
+	 * Positions are packed into one integer: y takes the lowest 16 bits, z the
+	 * next 24 bits and x the rest. Chunk changes have equal (null) blocks.
+	 */
+	struct Entry
+	{
+		std::int64_t position;
+		Block* before;
+		Block* after;
+	};
+	static constexpr std::uint64_t const unsubscribed = ~(std::uint64_t) 0;
+
+	mutable std::mutex mutex;
+	std::vector<Entry> entries;
+	std::uint64_t head; ///< Sequence number of the next change
+	/// Sequence number of the next change of each subscriber
+	std::vector<std::uint64_t> cursors;
+};
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_BLOCKJOURNAL_HPP_
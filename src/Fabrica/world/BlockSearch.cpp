@@ -0,0 +1,93 @@
+#include "World.hpp"
+
+#include <algorithm>
+
+namespace fab
+{
+
+namespace
+{
+
+/**
+ * Squared distance from p to the nearest point of [min, max].
+ */
+std::int64_t distance2(Vector3i const& p,
+                       Vector3i const& min, Vector3i const& max) noexcept
+{
+	std::int64_t d2 = 0;
+	for (int a = 0; a < 3; ++a)
+	{
+		std::int64_t const d = p[a] < min[a] ? min[a] - p[a] :
+		                       p[a] > max[a] ? p[a] - max[a] : 0;
+		d2 += d * d;
+	}
+	return d2;
+}
+
+} // namespace
+
+bool World::findNearest(Vector3i const& centre, int radius, Block* const block,
+                        Vector3i& position) const
+{
+	if (radius < 0) return false;
+
+	struct Candidate
+	{
+		std::int64_t distance2; ///< To the nearest block of the chunk
+		Vector3i chunk;
+		ChunkIn* c;
+	};
+	std::vector<Candidate> candidates;
+	std::int64_t best = (std::int64_t) radius * radius;
+	Vector3i min, max;
+	for (int a = 0; a < 3; ++a)
+	{
+		min[a] = divide_floor(centre[a] - radius, Chunk::size);
+		max[a] = divide_floor(centre[a] + radius, Chunk::size);
+	}
+	min.y() = std::max(min.y(), 0);
+	max.y() = std::min(max.y(), chunkYMax - 1);
+	for (int x = min.x(); x <= max.x(); ++x)
+		for (int y = min.y(); y <= max.y(); ++y)
+			for (int z = min.z(); z <= max.z(); ++z)
+			{
+				Vector3i const p(x, y, z);
+				ChunkIn* const c = getChunkO(p);
+				if (!c || !c->countBlock(block)) continue;
+				std::int64_t const d2 =
+				  distance2(centre, p * Chunk::size,
+				            p * Chunk::size + Vector3i::Constant(Chunk::size - 1));
+				if (d2 <= best)
+					candidates.push_back(Candidate{d2, p, c});
+			}
+	std::sort(candidates.begin(), candidates.end(),
+	          [](Candidate const& a, Candidate const& b)
+	{
+		return a.distance2 < b.distance2;
+	});
+
+	bool found = false;
+	for (auto const& candidate: candidates)
+	{
+		// No block of the remaining chunks can be nearer.
+		if (candidate.distance2 > best) break;
+		Vector3i const origin = candidate.chunk * Chunk::size;
+		for (int x = 0; x < Chunk::size; ++x)
+			for (int y = 0; y < Chunk::size; ++y)
+				for (int z = 0; z < Chunk::size; ++z)
+				{
+					if (candidate.c->getBlock(x, y, z) != block) continue;
+					Vector3i const p = origin + Vector3i(x, y, z);
+					std::int64_t const d2 = distance2(centre, p, p);
+					if (d2 < best || (d2 == best && !found))
+					{
+						best = d2;
+						position = p;
+						found = true;
+					}
+				}
+	}
+	return found;
+}
+
+} // namespace fab
@@ -0,0 +1,203 @@
+#include "World.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <set>
+#include <thread>
+#include <type_traits>
+
+namespace fab
+{
+
+namespace
+{
+
+/**
+ * Calls f(chunk, origin, lo, hi) on each loaded chunk overlapping the box of
+ * blocks [min, max], on nThreads threads. origin is the first block of the
+ * chunk and [lo, hi] the part of the box inside the chunk, in local
+ * coordinates. f returns a number of blocks.
+ *
+ * @return Position of each chunk and the result of f on it.
+ */
+template <typename W, typename F>
+std::vector<std::pair<Vector3i, std::size_t>>
+forChunks(W& world, Vector3i min, Vector3i max, unsigned int nThreads, F f)
+{
+	typedef typename std::remove_pointer<decltype(world.getChunkO(min))>::type
+	  ChunkT;
+	struct Span
+	{
+		ChunkT* chunk;
+		Vector3i position;
+		Vector3i lo, hi;
+	};
+
+	min = min.cwiseMax(Vector3i(-World::chunkXMax * Chunk::size, 0,
+	                            -World::chunkZMax * Chunk::size));
+	max = max.cwiseMin(Vector3i(World::chunkXMax * Chunk::size,
+	                            World::chunkYMax * Chunk::size,
+	                            World::chunkZMax * Chunk::size) -
+	                   Vector3i(1, 1, 1));
+	std::vector<Span> spans;
+	if ((min.array() <= max.array()).all())
+	{
+		Vector3i cMin, cMax;
+		for (int a = 0; a < 3; ++a)
+		{
+			cMin[a] = divide_floor(min[a], Chunk::size);
+			cMax[a] = divide_floor(max[a], Chunk::size);
+		}
+		for (int x = cMin.x(); x <= cMax.x(); ++x)
+			for (int y = cMin.y(); y <= cMax.y(); ++y)
+				for (int z = cMin.z(); z <= cMax.z(); ++z)
+				{
+					Vector3i const p(x, y, z);
+					ChunkT* const chunk = world.getChunkO(p);
+					if (!chunk) continue;
+					Vector3i const origin = p * Chunk::size;
+					spans.push_back(Span{chunk, p,
+					  (min - origin).cwiseMax(Vector3i(0, 0, 0)),
+					  (max - origin).cwiseMin(Vector3i::Constant(Chunk::size - 1))});
+				}
+	}
+
+	// Each thread takes the next chunk until all are done.
+	std::vector<std::size_t> counts(spans.size());
+	std::atomic<std::size_t> next(0);
+	auto worker = [&spans, &counts, &next, &f]()
+	{
+		for (std::size_t i = next++; i < spans.size(); i = next++)
+		{
+			Span const& s = spans[i];
+			counts[i] = f(*s.chunk, s.position * Chunk::size, s.lo, s.hi);
+		}
+	};
+	nThreads = std::min<std::size_t>(nThreads, spans.size());
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < nThreads; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for (auto& t: threads)
+		t.join();
+
+	std::vector<std::pair<Vector3i, std::size_t>> result;
+	result.reserve(spans.size());
+	for (std::size_t i = 0; i < spans.size(); ++i)
+		result.emplace_back(spans[i].position, counts[i]);
+	return result;
+}
+
+} // namespace
+
+std::size_t World::fill(Vector3i const& min, Vector3i const& max,
+                        Block* const block, unsigned int nThreads)
+{
+	auto const changes = forChunks(*this, min, max, nThreads,
+	  [block](Chunk& chunk, Vector3i const&,
+	          Vector3i const& lo, Vector3i const& hi)
+	{
+		std::size_t n = 0;
+		for (int x = lo.x(); x <= hi.x(); ++x)
+			for (int y = lo.y(); y <= hi.y(); ++y)
+				n += chunk.fillRow(x, y, lo.z(), hi.z() + 1, block);
+		return n;
+	});
+	return onBulkEdit(changes, nThreads);
+}
+std::size_t World::replace(Vector3i const& centre, int radius,
+                           Block* const from, Block* const to,
+                           unsigned int nThreads)
+{
+	if (from == to || radius < 0) return 0;
+
+	std::int64_t const r2 = (std::int64_t) radius * radius;
+	auto const changes = forChunks(*this, centre - Vector3i::Constant(radius),
+	                               centre + Vector3i::Constant(radius), nThreads,
+	  [&centre, r2, from, to](Chunk& chunk, Vector3i const& origin,
+	                          Vector3i const& lo, Vector3i const& hi)
+	{
+		std::size_t n = 0;
+		for (int x = lo.x(); x <= hi.x(); ++x)
+			for (int y = lo.y(); y <= hi.y(); ++y)
+			{
+				std::int64_t const dx = origin.x() + x - centre.x();
+				std::int64_t const dy = origin.y() + y - centre.y();
+				std::int64_t const rest = r2 - dx * dx - dy * dy;
+				if (rest < 0) continue;
+				// Half the length of the row in the ball, rounded down
+				std::int64_t h = (std::int64_t) std::sqrt((double) rest);
+				while (h * h > rest) --h;
+				while ((h + 1) * (h + 1) <= rest) ++h;
+
+				int const z0 = std::max<int>(lo.z(), centre.z() - h - origin.z());
+				int const z1 = std::min<int>(hi.z(), centre.z() + h - origin.z());
+				if (z0 <= z1)
+					n += chunk.replaceRow(x, y, z0, z1 + 1, from, to);
+			}
+		return n;
+	});
+	return onBulkEdit(changes, nThreads);
+}
+std::size_t World::count(Vector3i const& min, Vector3i const& max,
+                         Block* const block, unsigned int nThreads) const
+{
+	auto const counts = forChunks(*this, min, max, nThreads,
+	  [block](ChunkIn& chunk, Vector3i const&,
+	          Vector3i const& lo, Vector3i const& hi) -> std::size_t
+	{
+		int const nChunk = chunk.countBlock(block);
+		if (!nChunk ||
+		    (lo == Vector3i(0, 0, 0) &&
+		     hi == Vector3i::Constant(Chunk::size - 1)))
+			return nChunk;
+
+		std::size_t n = 0;
+		for (int x = lo.x(); x <= hi.x(); ++x)
+			for (int y = lo.y(); y <= hi.y(); ++y)
+				n += chunk.countRow(x, y, lo.z(), hi.z() + 1, block);
+		return n;
+	});
+	std::size_t total = 0;
+	for (auto const& c: counts)
+		total += c.second;
+	return total;
+}
+
+std::size_t
+World::onBulkEdit(std::vector<std::pair<Vector3i, std::size_t>> const& changes,
+                  unsigned int nThreads)
+{
+	std::size_t total = 0;
+	std::set<std::pair<int, int>> edited;
+	std::set<std::pair<int, int>> columns;
+	for (auto const& c: changes)
+	{
+		if (!c.second) continue;
+		total += c.second;
+		getChunkO(c.first)->touch();
+		journal.appendChunk(c.first);
+		edited.insert(std::make_pair(c.first.x(), c.first.z()));
+		// Light from the column may have spread into its neighbours.
+		for (int x = -1; x <= 1; ++x)
+			for (int z = -1; z <= 1; ++z)
+				columns.insert(std::make_pair(c.first.x() + x, c.first.z() + z));
+	}
+	if (columns.empty()) return 0;
+
+	for (auto const& c: edited)
+	{
+		ChunkColumn& column = *getColumnO(Vector2i(c.first, c.second));
+		column.getHeightmap().compute(column);
+	}
+
+	std::vector<Vector2i> relit;
+	for (auto const& c: columns)
+		relit.push_back(Vector2i(c.first, c.second));
+	light.lightColumns(relit);
+	light.update(nThreads);
+	return total;
+}
+
+} // namespace fab
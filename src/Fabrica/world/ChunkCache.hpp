@@ -0,0 +1,77 @@
+#ifndef FABRICA_WORLD_CHUNKCACHE_HPP_
+#define FABRICA_WORLD_CHUNKCACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "World.hpp"
+
+namespace fab
+{
+
+/**
+ * @brief Direct-mapped cache of chunk lookups for world queries. Unloaded
+ *  chunks are cached as nullptr, so the world must not change while the cache
+ *  is in use.
+ */
+class ChunkCache final
+{
+public:
+	ChunkCache(WorldIn& world) noexcept: world(world)
+	{
+		for (auto& k: keys) k = -1;
+	}
+
+	/**
+	 * @brief Gets a chunk. The position must be valid.
+	 */
+	ChunkIn* get(Vector3i const& p) noexcept
+	{
+		std::int64_t const key = World::chunkKey(p);
+		int const i = (p.x() * 5 + p.y() * 3 + p.z()) & (nEntries - 1);
+		if (keys[i] != key)
+		{
+			keys[i] = key;
+			chunks[i] = world.getChunkO(p);
+		}
+		return chunks[i];
+	}
+
+private:
+	static constexpr int const nEntries = 16;
+
+	WorldIn& world;
+	std::int64_t keys[nEntries];
+	ChunkIn* chunks[nEntries];
+};
+
+/**
+ * @brief Answers n queries with f(query, cache) on nThreads threads. Each
+ *  thread takes a contiguous range, since neighbouring queries usually touch
+ *  the same chunks, and keeps its own cache.
+ */
+template <typename Query, typename Result, typename F>
+void queryBatch(WorldIn& world, Query const* queries, Result* results,
+                std::size_t n, unsigned int nThreads, F f)
+{
+	if (nThreads < 1) nThreads = 1;
+	auto worker = [&world, queries, results, n, nThreads, &f](unsigned int k)
+	{
+		ChunkCache cache(world);
+		std::size_t const end = n * (k + 1) / nThreads;
+		for (std::size_t i = n * k / nThreads; i < end; ++i)
+			results[i] = f(queries[i], cache);
+	};
+	std::vector<std::thread> threads;
+	for (unsigned int k = 1; k < nThreads; ++k)
+		threads.emplace_back(worker, k);
+	worker(0);
+	for (auto& t: threads)
+		t.join();
+}
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_CHUNKCACHE_HPP_
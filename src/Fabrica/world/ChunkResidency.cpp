@@ -0,0 +1,51 @@
+#include "ChunkResidency.hpp"
+
+namespace fab
+{
+
+constexpr std::size_t const ChunkResidency::defaultBudget;
+
+ChunkResidency::ChunkResidency(std::size_t budget) noexcept:
+	budget(budget), bytes(0),
+	hits(0), misses(0), evictions(0), saves(0)
+{
+}
+
+void ChunkResidency::onLoad(std::int64_t key, Vector2i const& position,
+                            std::size_t storage)
+{
+	onUnload(key); // Replacing a column
+	lru.push_front(key);
+	entries[key] = Entry{lru.begin(), position, storage, 0};
+	bytes += storage;
+}
+void ChunkResidency::onUnload(std::int64_t key)
+{
+	auto it = entries.find(key);
+	if (it == entries.end()) return;
+	bytes -= it->second.storage + it->second.mesh;
+	lru.erase(it->second.lru);
+	entries.erase(it);
+}
+void ChunkResidency::setMeshBytes(std::int64_t key, std::size_t mesh) noexcept
+{
+	auto it = entries.find(key);
+	if (it == entries.end()) return;
+	bytes = bytes - it->second.mesh + mesh;
+	it->second.mesh = mesh;
+}
+
+ResidencyStats ChunkResidency::stats() const noexcept
+{
+	ResidencyStats s;
+	s.hits = hits;
+	s.misses = misses;
+	s.evictions = evictions;
+	s.saves = saves;
+	s.nColumns = entries.size();
+	s.bytes = bytes;
+	s.budget = budget;
+	return s;
+}
+
+} // namespace fab
@@ -0,0 +1,144 @@
+#ifndef FABRICA_WORLD_CHUNKRESIDENCY_HPP_
+#define FABRICA_WORLD_CHUNKRESIDENCY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "../util/vector.hpp"
+
+namespace fab
+{
+
+/**
+ * @brief Counters of a {@code ChunkResidency}, for tuning the budget.
+ */
+struct ResidencyStats
+{
+	std::uint64_t hits; ///< Requested columns that were resident
+	std::uint64_t misses; ///< Requested columns that had to be loaded
+	std::uint64_t evictions; ///< Columns removed to meet the budget
+	std::uint64_t saves; ///< Dirty chunks saved before eviction
+	std::size_t nColumns; ///< Resident chunk columns
+	std::size_t bytes; ///< Bytes used by resident columns and their meshes
+	std::size_t budget; ///< Budget in bytes
+};
+
+/**
+ * @brief Tracks the memory used by the resident chunk columns of a
+ *  {@code World} and the order in which they were last requested.
+ *
+ * The bytes of a column are the storage of the column and the size of any
+ * meshes built from its sections (reported by the renderer).
+ * {@code ChunkResidency} only does the bookkeeping; {@code World} removes the
+ * columns selected by {@code selectVictims}.
+ *
+ * Not thread-safe.
+ */
+class ChunkResidency final
+{
+public:
+	static constexpr std::size_t const defaultBudget = 512 << 20; // 512 MiB
+
+	ChunkResidency(std::size_t budget = defaultBudget) noexcept;
+
+	void setBudget(std::size_t b) noexcept { budget = b; }
+	std::size_t getBudget() const noexcept { return budget; }
+	std::size_t getBytes() const noexcept { return bytes; }
+	bool overBudget() const noexcept { return bytes > budget; }
+
+	/**
+	 * @brief Registers a newly loaded column as the most recently used.
+	 * @param[in] storage Bytes of column storage.
+	 */
+	void onLoad(std::int64_t key, Vector2i const& position,
+	            std::size_t storage);
+	/**
+	 * @brief Forgets a column. Does nothing if the column is not registered.
+	 */
+	void onUnload(std::int64_t key);
+	/**
+	 * @brief Marks a resident column as the most recently used and counts a
+	 *  hit.
+	 */
+	void onHit(std::int64_t key) noexcept;
+	/**
+	 * @brief Marks a resident column as the most recently used, without
+	 *  counting a hit.
+	 */
+	void onUse(std::int64_t key) noexcept;
+	/**
+	 * @brief Sets the bytes of the meshes of a column. Ignored if the column
+	 *  is not resident.
+	 */
+	void setMeshBytes(std::int64_t key, std::size_t mesh) noexcept;
+
+	void countMiss() noexcept { ++misses; }
+	void countEviction() noexcept { ++evictions; }
+	void countSave() noexcept { ++saves; }
+
+	/**
+	 * @brief Selects columns to evict until the bytes drop below the budget.
+	 * @param[in] evictable Predicate on the column position. Columns that are
+	 *  in range, or that cannot be evicted, must be rejected.
+	 * @return Keys of the selected columns, least recently used first. The
+	 *  columns are not unregistered.
+	 */
+	template <typename Predicate>
+	std::vector<std::int64_t> selectVictims(Predicate evictable) const;
+
+	ResidencyStats stats() const noexcept;
+
+private:
+	struct Entry
+	{
+		std::list<std::int64_t>::iterator lru;
+		Vector2i position;
+		std::size_t storage;
+		std::size_t mesh;
+	};
+
+	std::size_t budget;
+	std::size_t bytes;
+
+	std::list<std::int64_t> lru; ///< Most recently used at the front
+	std::unordered_map<std::int64_t, Entry> entries;
+
+	std::uint64_t hits, misses, evictions, saves;
+};
+
+// Implementations
+
+inline void ChunkResidency::onHit(std::int64_t key) noexcept
+{
+	auto it = entries.find(key);
+	if (it == entries.end()) return;
+	lru.splice(lru.begin(), lru, it->second.lru);
+	++hits;
+}
+inline void ChunkResidency::onUse(std::int64_t key) noexcept
+{
+	auto it = entries.find(key);
+	if (it == entries.end()) return;
+	lru.splice(lru.begin(), lru, it->second.lru);
+}
+template <typename Predicate> std::vector<std::int64_t>
+ChunkResidency::selectVictims(Predicate evictable) const
+{
+	std::vector<std::int64_t> victims;
+	std::size_t remaining = bytes;
+	for (auto it = lru.rbegin(); it != lru.rend() && remaining > budget; ++it)
+	{
+		Entry const& e = entries.at(*it);
+		if (!evictable(e.position)) continue;
+		victims.push_back(*it);
+		remaining -= e.storage + e.mesh;
+	}
+	return victims;
+}
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_CHUNKRESIDENCY_HPP_
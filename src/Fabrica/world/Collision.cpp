@@ -0,0 +1,173 @@
+#include "World.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "ChunkCache.hpp"
+
+namespace fab
+{
+
+namespace
+{
+
+/**
+ * Tolerance of the box against block boundaries. Box coordinates are floats,
+ * whose precision near the world border is about 1/2000 of a block.
+ */
+double const epsilon = 1e-3;
+
+/**
+ * @brief Tests whether a block face stops a moving box.
+ * @param[out] block The block, or nullptr if it is not loaded.
+ */
+bool isSolid(ChunkCache& cache, Vector3i const& p, Facing3 face,
+             Block** block) noexcept
+{
+	*block = nullptr;
+	if (p.y() < 0 || p.y() >= World::chunkYMax * Chunk::size)
+		return false;
+	Vector3i const chunkPos(divide_floor(p.x(), Chunk::size),
+	                        p.y() / Chunk::size,
+	                        divide_floor(p.z(), Chunk::size));
+	if (!World::isValidChunk(chunkPos))
+		return true;
+	ChunkIn* const chunk = cache.get(chunkPos);
+	if (!chunk)
+		return true;
+	*block = chunk->getBlock(p - Chunk::size * chunkPos);
+	return (*block)->isSideSolid(face);
+}
+
+/**
+ * The leading face of the box moves through the block grid like a ray. Each
+ * time it crosses a block boundary on an axis, the layer of blocks it enters
+ * is tested, limited to the extent of the box on the other two axes at that
+ * time.
+ */
+SweepHit sweepBox(Sweep const& s, ChunkCache& cache) noexcept
+{
+	assert(s.box.min.x() <= s.box.max.x() &&
+	       s.box.min.y() <= s.box.max.y() &&
+	       s.box.min.z() <= s.box.max.z() &&
+	       "class World: Box is inverted");
+	SweepHit result;
+	result.hit = false;
+	result.time = 1.f;
+	result.face = static_cast<Facing3>(0);
+	result.position = Vector3i::Zero();
+	result.block = nullptr;
+
+	// Face hit when moving in the positive and negative direction of each axis
+	static Facing3 const facesPos[3] =
+	  {Facing3::West, Facing3::Down, Facing3::North};
+	static Facing3 const facesNeg[3] =
+	  {Facing3::East, Facing3::Up, Facing3::South};
+
+	double lo[3], hi[3], d[3];
+	int step[3];
+	int lead[3]; // Layer of blocks containing the leading face
+	double tNext[3], tDelta[3];
+	for (int a = 0; a < 3; ++a)
+	{
+		lo[a] = s.box.min[a];
+		hi[a] = s.box.max[a];
+		d[a] = s.displacement[a];
+		if (d[a] > 0.)
+		{
+			step[a] = 1;
+			lead[a] = (int) std::floor(hi[a] - epsilon);
+			tDelta[a] = 1. / d[a];
+			tNext[a] = (lead[a] + 1 - hi[a]) * tDelta[a];
+		}
+		else if (d[a] < 0.)
+		{
+			step[a] = -1;
+			lead[a] = (int) std::floor(lo[a] + epsilon);
+			tDelta[a] = -1. / d[a];
+			tNext[a] = (lo[a] - lead[a]) * tDelta[a];
+		}
+		else
+		{
+			step[a] = 0;
+			lead[a] = 0;
+			tDelta[a] = tNext[a] = std::numeric_limits<double>::infinity();
+		}
+	}
+
+	for (;;)
+	{
+		int const a = tNext[0] < tNext[1] ?
+		              (tNext[0] < tNext[2] ? 0 : 2) :
+		              (tNext[1] < tNext[2] ? 1 : 2);
+		double const t = std::max(0., tNext[a]);
+		if (t > 1.) return result;
+		lead[a] += step[a];
+		tNext[a] += tDelta[a];
+
+		int from[3], to[3];
+		for (int b = 0; b < 3; ++b)
+		{
+			from[b] = (int) std::floor(lo[b] + d[b] * t + epsilon);
+			to[b] = (int) std::floor(hi[b] + d[b] * t - epsilon);
+		}
+		from[a] = to[a] = lead[a];
+		Facing3 const face = step[a] > 0 ? facesPos[a] : facesNeg[a];
+		for (int x = from[0]; x <= to[0]; ++x)
+			for (int z = from[2]; z <= to[2]; ++z)
+				for (int y = from[1]; y <= to[1]; ++y)
+				{
+					Vector3i const p(x, y, z);
+					Block* block;
+					if (isSolid(cache, p, face, &block))
+					{
+						result.hit = true;
+						result.time = (float) t;
+						result.face = face;
+						result.position = p;
+						result.block = block;
+						return result;
+					}
+				}
+	}
+}
+
+} // namespace
+
+SweepHit World::sweep(Sweep const& s) const noexcept
+{
+	ChunkCache cache(*this);
+	return sweepBox(s, cache);
+}
+void World::sweep(Sweep const* sweeps, SweepHit* hits, std::size_t n,
+                  unsigned int nThreads) const
+{
+	queryBatch(*this, sweeps, hits, n, nThreads, sweepBox);
+}
+Vector3f World::slide(AABB const& box,
+                      Vector3f const& displacement) const noexcept
+{
+	ChunkCache cache(*this);
+	Sweep s{box, displacement};
+	Vector3f moved = Vector3f::Zero();
+	// Each impact blocks one axis, so there are at most three.
+	for (int i = 0; i < 3 && !s.displacement.isZero(0.f); ++i)
+	{
+		SweepHit const h = sweepBox(s, cache);
+		Vector3f const step = s.displacement * h.time;
+		moved += step;
+		s.box.min += step;
+		s.box.max += step;
+		if (!h.hit) break;
+
+		s.displacement -= step;
+		Vector3i const normal = toFace(h.face);
+		for (int a = 0; a < 3; ++a)
+			if (normal[a]) s.displacement[a] = 0.f;
+	}
+	return moved;
+}
+
+} // namespace fab
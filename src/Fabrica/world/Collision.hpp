@@ -0,0 +1,51 @@
+#ifndef FABRICA_WORLD_COLLISION_HPP_
+#define FABRICA_WORLD_COLLISION_HPP_
+
+#include "../block/Block.hpp"
+#include "../util/facing.hpp"
+#include "../util/vector.hpp"
+
+namespace fab
+{
+
+/**
+ * @brief Axis-aligned box, in block units.
+ */
+struct AABB
+{
+	Vector3f min;
+	Vector3f max;
+};
+
+/**
+ * @brief A box moving by a displacement, for {@code World::sweep}.
+ */
+struct Sweep
+{
+	AABB box;
+	Vector3f displacement;
+};
+
+/**
+ * @brief Result of {@code World::sweep}.
+ */
+struct SweepHit
+{
+	bool hit;
+	/**
+	 * Fraction of the displacement travelled before the impact, in [0, 1]. 1 if
+	 * nothing was hit.
+	 */
+	float time;
+	/**
+	 * Face of the block that was hit. {@code toFace(face)} is the normal of
+	 * the impact.
+	 */
+	Facing3 face;
+	Vector3i position; ///< Position of the block hit
+	Block* block; ///< nullptr for unloaded chunks and the world border
+};
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_COLLISION_HPP_
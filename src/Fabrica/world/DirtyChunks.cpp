@@ -0,0 +1,70 @@
+#include "DirtyChunks.hpp"
+
+#include <cstdlib>
+
+#include "World.hpp"
+
+namespace fab
+{
+
+void DirtyChunks::markBlock(Vector3i const& p)
+{
+	Vector3i const chunk(divide_floor(p.x(), Chunk::size),
+	                     divide_floor(p.y(), Chunk::size),
+	                     divide_floor(p.z(), Chunk::size));
+	// Neighbour offset of the block on each axis: -1 or 1 on the border of the
+	// chunk, 0 inside.
+	Vector3i side;
+	for (int a = 0; a < 3; ++a)
+	{
+		int const local = p[a] - chunk[a] * Chunk::size;
+		side[a] = local == 0 ? -1 : local == Chunk::size - 1 ? 1 : 0;
+	}
+
+	markChunk(chunk);
+	if (diagonal)
+	{
+		// Every combination of the borders touched
+		for (int x = 0; x <= (side.x() != 0); ++x)
+			for (int y = 0; y <= (side.y() != 0); ++y)
+				for (int z = 0; z <= (side.z() != 0); ++z)
+					if (x || y || z)
+						markChunk(chunk + Vector3i(x * side.x(),
+						                           y * side.y(),
+						                           z * side.z()));
+	}
+	else
+	{
+		for (int a = 0; a < 3; ++a)
+			if (side[a])
+			{
+				Vector3i neighbour = chunk;
+				neighbour[a] += side[a];
+				markChunk(neighbour);
+			}
+	}
+}
+void DirtyChunks::markBlocks(Vector3i const& chunk)
+{
+	for (int x = -1; x <= 1; ++x)
+		for (int y = -1; y <= 1; ++y)
+			for (int z = -1; z <= 1; ++z)
+				if (diagonal || std::abs(x) + std::abs(y) + std::abs(z) <= 1)
+					markChunk(chunk + Vector3i(x, y, z));
+}
+void DirtyChunks::markChunk(Vector3i const& position)
+{
+	if (World::isValidChunk(position))
+		keys.insert(World::chunkKey(position));
+}
+std::vector<Vector3i> DirtyChunks::take()
+{
+	std::vector<Vector3i> result;
+	result.reserve(keys.size());
+	for (auto key: keys)
+		result.push_back(World::chunkPosition(key));
+	keys.clear();
+	return result;
+}
+
+} // namespace fab
@@ -0,0 +1,63 @@
+#ifndef FABRICA_WORLD_DIRTYCHUNKS_HPP_
+#define FABRICA_WORLD_DIRTYCHUNKS_HPP_
+
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "../util/vector.hpp"
+
+namespace fab
+{
+
+/**
+ * @brief Set of chunks whose meshes must be rebuilt after block changes.
+ *
+ * The mesh of a chunk depends on its own blocks and on the blocks next to its
+ * border. A changed block therefore dirties its own chunk, plus the neighbours
+ * across each face, edge or corner of the chunk that the block touches. Only
+ * face neighbours are needed if meshes only look at the six blocks next to
+ * each face; edge and corner neighbours are needed if they also look at
+ * diagonal blocks (e.g. for ambient occlusion).
+ *
+ * Marking the same chunk several times keeps one entry, so a batch of edits
+ * costs one rebuild per chunk.
+ */
+class DirtyChunks final
+{
+public:
+	/**
+	 * @param[in] diagonal Whether meshes depend on diagonal blocks, so that
+	 *  edge and corner neighbours are marked too.
+	 */
+	DirtyChunks(bool diagonal = false) noexcept: diagonal(diagonal) {}
+
+	/**
+	 * @brief Marks the chunks whose meshes depend on a block.
+	 */
+	void markBlock(Vector3i const& position);
+	/**
+	 * @brief Marks the chunks whose meshes depend on any block of a chunk:
+	 *  the chunk and its neighbours.
+	 */
+	void markBlocks(Vector3i const& chunk);
+	/**
+	 * @brief Marks a chunk. Invalid chunks are ignored.
+	 */
+	void markChunk(Vector3i const& position);
+
+	bool empty() const noexcept { return keys.empty(); }
+	std::size_t size() const noexcept { return keys.size(); }
+	/**
+	 * @brief Returns the marked chunks and clears the set.
+	 */
+	std::vector<Vector3i> take();
+
+private:
+	bool diagonal;
+	std::unordered_set<std::int64_t> keys;
+};
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_DIRTYCHUNKS_HPP_
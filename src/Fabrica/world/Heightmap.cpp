@@ -0,0 +1,63 @@
+#include "Heightmap.hpp"
+
+#include <cstring>
+
+#include "chunk/ChunkColumn.hpp"
+
+namespace fab
+{
+
+Heightmap::Heightmap() noexcept
+{
+	std::memset(heights, 0, sizeof(heights));
+}
+
+void Heightmap::compute(ChunkColumn const& column) noexcept
+{
+	for (int x = 0; x < Chunk::size; ++x)
+		for (int z = 0; z < Chunk::size; ++z)
+		{
+			// One scan downwards until every kind has found its top.
+			int nFound = 0;
+			for (int k = 0; k < nKinds; ++k)
+				heights[k][x][z] = 0;
+			for (int y = ChunkColumn::height * Chunk::size - 1;
+			     y >= 0 && nFound < nKinds; --y)
+			{
+				Block* const b = column.getSection(y / Chunk::size).getBlock(
+				  x, y % Chunk::size, z);
+				if (b == &BlockNull::instance) continue;
+				for (int k = 0; k < nKinds; ++k)
+					if (!heights[k][x][z] && isTop((Kind) k, b))
+					{
+						heights[k][x][z] = y + 1;
+						++nFound;
+					}
+			}
+		}
+}
+void Heightmap::onBlockChanged(ChunkColumn const& column,
+                               int x, int y, int z,
+                               Block* const after) noexcept
+{
+	for (int k = 0; k < nKinds; ++k)
+	{
+		std::uint16_t& h = heights[k][x][z];
+		if (isTop((Kind) k, after))
+		{
+			if (y >= h) h = y + 1;
+		}
+		else if (y + 1 == h)
+		{
+			// The top block was removed; find the next one down.
+			int next = y - 1;
+			while (next >= 0 &&
+			       !isTop((Kind) k, column.getSection(next / Chunk::size)
+			                          .getBlock(x, next % Chunk::size, z)))
+				--next;
+			h = next + 1;
+		}
+	}
+}
+
+} // namespace fab
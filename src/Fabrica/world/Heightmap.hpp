@@ -0,0 +1,78 @@
+#ifndef FABRICA_WORLD_HEIGHTMAP_HPP_
+#define FABRICA_WORLD_HEIGHTMAP_HPP_
+
+#include <cstdint>
+
+#include "chunk/Chunk.hpp"
+
+namespace fab
+{
+
+class ChunkColumn;
+
+/**
+ * @brief Heights of the top blocks of a chunk column, for each cell [x, z].
+ *
+ * Three kinds of top block are tracked: any block other than
+ * {@code BlockNull} (SURFACE), opaque blocks (OPAQUE, where sky light stops)
+ * and blocks with a solid top face (MOTION_BLOCKING, which entities stand
+ * on). A height is the y of the top block plus one, or 0 if the cell has no
+ * such block, so it is also the lowest y open to the sky.
+ *
+ * After a block change, the heights only have to be searched downwards when
+ * the top block itself is removed, and then only down to the next one.
+ */
+class Heightmap final
+{
+public:
+	enum Kind
+	{
+		SURFACE,
+		OPAQUE,
+		MOTION_BLOCKING,
+		nKinds
+	};
+
+	/**
+	 * @brief Whether a block counts as a top block of the given kind.
+	 */
+	static bool isTop(Kind, Block* const) noexcept;
+
+	Heightmap() noexcept; ///< All heights 0
+
+	int get(Kind kind, int x, int z) const noexcept
+	{
+		return heights[kind][x][z];
+	}
+	/**
+	 * @brief Computes the heights from the blocks of a column.
+	 */
+	void compute(ChunkColumn const& column) noexcept;
+	/**
+	 * @brief Updates the heights after the block [x, y, z] of the column
+	 *  (local in x and z) has been set to after.
+	 */
+	void onBlockChanged(ChunkColumn const& column, int x, int y, int z,
+	                    Block* const after) noexcept;
+
+private:
+	std::uint16_t heights[nKinds][Chunk::size][Chunk::size];
+};
+
+// Implementations
+
+inline bool
+Heightmap::isTop(Kind kind, Block* const b) noexcept
+{
+	switch (kind)
+	{
+	case SURFACE: return b != &BlockNull::instance;
+	case OPAQUE: return b->isOpaque();
+	case MOTION_BLOCKING: return b->isSideSolid(Facing3::Up);
+	default: return false;
+	}
+}
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_HEIGHTMAP_HPP_
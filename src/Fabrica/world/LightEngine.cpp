@@ -0,0 +1,396 @@
+#include "LightEngine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <atomic>
+#include <thread>
+
+#include "World.hpp"
+
+namespace fab
+{
+
+namespace
+{
+
+int const dx[6] = {-1, 1, 0, 0, 0, 0};
+int const dy[6] = {0, 0, -1, 1, 0, 0};
+int const dz[6] = {0, 0, 0, 0, -1, 1};
+int const dDown = 2;
+
+inline Block* blockAt(ChunkIn& chunk, int cell) noexcept
+{
+	return chunk.getBlock(cell >> 8, (cell >> 4) & 0xF, cell & 0xF);
+}
+inline int lightAt(ChunkIn& chunk, int cell, bool sky) noexcept
+{
+	return sky ? chunk.getSkyLight(cell) : chunk.getBlockLight(cell);
+}
+inline void setLight(Chunk& chunk, int cell, bool sky, int level) noexcept
+{
+	if (sky)
+		chunk.setSkyLight(cell, level);
+	else
+		chunk.setBlockLight(cell, level);
+}
+/**
+ * @brief Neighbour of a cell in direction d.
+ * @param[out] offset Offset of the chunk containing the neighbour.
+ * @return Cell of the neighbour in its chunk.
+ */
+inline int neighbour(int cell, int d, Vector3i* offset) noexcept
+{
+	int x = (cell >> 8) + dx[d];
+	int y = ((cell >> 4) & 0xF) + dy[d];
+	int z = (cell & 0xF) + dz[d];
+	*offset = Vector3i(divide_floor(x, Chunk::size),
+	                   divide_floor(y, Chunk::size),
+	                   divide_floor(z, Chunk::size));
+	return Chunk::cell(modulo_floor(x, Chunk::size),
+	                   modulo_floor(y, Chunk::size),
+	                   modulo_floor(z, Chunk::size));
+}
+
+} // namespace
+
+constexpr int const LightEngine::levelMax;
+
+LightEngine::LightEngine(World* const world) noexcept:
+	world(world)
+{
+}
+
+void LightEngine::lightColumns(std::vector<Vector2i> const& columns)
+{
+	int const top = World::chunkYMax * Chunk::size;
+	typedef std::array<std::array<int, Chunk::size>, Chunk::size> Heights;
+
+	// Cells from the height of a column up to the top of the world see the sky.
+	std::map<std::pair<int, int>, Heights> heights;
+	for (auto const& c: columns)
+	{
+		ChunkColumn* const column = world->getColumnO(c);
+		if (!column) continue;
+
+		Heights& h = heights[std::make_pair(c.x(), c.y())];
+		for (int y = 0; y < World::chunkYMax; ++y)
+			column->getSection(y).clearLight();
+		for (int x = 0; x < Chunk::size; ++x)
+			for (int z = 0; z < Chunk::size; ++z)
+			{
+				h[x][z] = column->getHeightmap().get(Heightmap::OPAQUE, x, z);
+				for (int y = h[x][z]; y < top; ++y)
+				{
+					column->getSection(y / Chunk::size).setSkyLight(
+					  Chunk::cell(x, y % Chunk::size, z), levelMax);
+				}
+			}
+	}
+	/*
+	 * Height of a column next to a lit one. Columns lit before are read from
+	 * their sky light. Unloaded columns count as high, since they pull the light
+	 * in when they are lit.
+	 */
+	auto heightNear = [this, &heights, top](int cx, int cz, int x, int z)
+	{
+		cx += divide_floor(x, Chunk::size);
+		cz += divide_floor(z, Chunk::size);
+		x = modulo_floor(x, Chunk::size);
+		z = modulo_floor(z, Chunk::size);
+		auto it = heights.find(std::make_pair(cx, cz));
+		if (it != heights.end())
+			return it->second[x][z];
+		ChunkColumn const* const c = world->getColumnO(Vector2i(cx, cz));
+		if (!c) return 0;
+		int y = top;
+		for (; y > 0; --y)
+		{
+			ChunkIn& section = c->getSection((y - 1) / Chunk::size);
+			if (section.getSkyLight(Chunk::cell(x, (y - 1) % Chunk::size, z)) !=
+			    levelMax)
+				break;
+		}
+		return y == top ? 0 : y;
+	};
+
+	for (auto const& column: heights)
+	{
+		int const cx = column.first.first;
+		int const cz = column.first.second;
+		Heights const& h = column.second;
+		auto const key = [cx, cz](int y)
+		{
+			return World::chunkKey(Vector3i(cx, y, cz));
+		};
+
+		// Sky light only spreads sideways where a neighbouring column is lower.
+		for (int x = 0; x < Chunk::size; ++x)
+			for (int z = 0; z < Chunk::size; ++z)
+			{
+				int spread = 0;
+				for (int d: {0, 1, 4, 5})
+					spread = std::max(spread, heightNear(cx, cz, x + dx[d], z + dz[d]));
+				for (int y = h[x][z]; y < spread; ++y)
+				{
+					work[key(y / Chunk::size)].add.push_back(
+					  Node{(std::uint16_t) Chunk::cell(x, y % Chunk::size, z),
+					       levelMax, FLAG_SKY | FLAG_FORCE});
+				}
+			}
+
+		for (int y = 0; y < World::chunkYMax; ++y)
+		{
+			Chunk& c = *world->getChunkO(Vector3i(cx, y, cz));
+			Work& w = work[key(y)];
+
+			// Sources of block light. Neighbouring blocks are usually equal.
+			Block* last = nullptr;
+			int e = 0;
+			for (int cell = 0; cell < Chunk::volume; ++cell)
+			{
+				Block* const b = blockAt(c, cell);
+				if (b != last)
+				{
+					last = b;
+					e = b->getLightEmission();
+				}
+				if (e == 0) continue;
+				c.setBlockLight(cell, e);
+				w.add.push_back(Node{(std::uint16_t) cell, (std::uint8_t) e,
+				                     FLAG_FORCE});
+			}
+
+			// Light of the columns lit before flows in.
+			for (int d: {0, 1, 4, 5})
+			{
+				if (heights.count(std::make_pair(cx + dx[d], cz + dz[d])))
+					continue;
+				ChunkIn* n = world->getChunkO(Vector3i(cx + dx[d], y, cz + dz[d]));
+				if (!n) continue;
+				int const edge = dx[d] + dz[d] < 0 ? 0 : Chunk::size - 1;
+				for (int a = 0; a < Chunk::size; ++a)
+					for (int b = 0; b < Chunk::size; ++b)
+					{
+						// a is y, b is the other horizontal axis
+						int const cell = dx[d] ? Chunk::cell(edge, a, b) :
+						                         Chunk::cell(b, a, edge);
+						int const cellN = dx[d] ?
+						  Chunk::cell(Chunk::size - 1 - edge, a, b) :
+						  Chunk::cell(b, a, Chunk::size - 1 - edge);
+						int const sky = n->getSkyLight(cellN) - 1;
+						int const block = n->getBlockLight(cellN) - 1;
+						if (sky > c.getSkyLight(cell))
+							w.add.push_back(Node{(std::uint16_t) cell,
+							                     (std::uint8_t) sky, FLAG_SKY});
+						if (block > c.getBlockLight(cell))
+							w.add.push_back(Node{(std::uint16_t) cell,
+							                     (std::uint8_t) block, 0});
+					}
+			}
+		}
+	}
+}
+void LightEngine::onBlockChanged(Vector3i const& p, Block* before, Block* after)
+{
+	if (before->isOpaque() == after->isOpaque() &&
+	    before->getLightEmission() == after->getLightEmission())
+		return; // Light is unaffected
+
+	Vector3i const pChunk(divide_floor(p.x(), Chunk::size),
+	                      divide_floor(p.y(), Chunk::size),
+	                      divide_floor(p.z(), Chunk::size));
+	Chunk* const c = world->getChunkO(pChunk);
+	if (!c) return;
+	int const cell = Chunk::cell(modulo_floor(p.x(), Chunk::size),
+	                             modulo_floor(p.y(), Chunk::size),
+	                             modulo_floor(p.z(), Chunk::size));
+	Work& w = work[World::chunkKey(pChunk)];
+
+	// Darken the cell; the removal relights it from the remaining sources.
+	int const levelBlock = c->getBlockLight(cell);
+	if (levelBlock > 0)
+	{
+		c->setBlockLight(cell, 0);
+		w.remove.push_back(Node{(std::uint16_t) cell, (std::uint8_t) levelBlock,
+		                        FLAG_FORCE});
+	}
+	int const e = after->getLightEmission();
+	if (e > 0)
+	{
+		c->setBlockLight(cell, e);
+		w.add.push_back(Node{(std::uint16_t) cell, (std::uint8_t) e, FLAG_FORCE});
+	}
+	int const levelSky = c->getSkyLight(cell);
+	if (after->isOpaque() && levelSky > 0)
+	{
+		c->setSkyLight(cell, 0);
+		w.remove.push_back(Node{(std::uint16_t) cell, (std::uint8_t) levelSky,
+		                        FLAG_SKY | FLAG_FORCE});
+	}
+
+	if (after->isOpaque()) return;
+	// Light flows in from the neighbours
+	for (int d = 0; d < 6; ++d)
+	{
+		Vector3i offset;
+		int const cellN = neighbour(cell, d, &offset);
+		queue(pChunk + offset, Node{(std::uint16_t) cellN, 0,
+		                            FLAG_SKY | FLAG_FORCE}, false);
+		queue(pChunk + offset, Node{(std::uint16_t) cellN, 0, FLAG_FORCE}, false);
+	}
+	if (p.y() == World::chunkYMax * Chunk::size - 1)
+		w.add.push_back(Node{(std::uint16_t) cell, levelMax, FLAG_SKY});
+}
+
+void LightEngine::update(unsigned int nThreads)
+{
+	while (round(true, nThreads));
+	while (round(false, nThreads));
+	work.clear();
+}
+
+bool LightEngine::round(bool removal, unsigned int nThreads)
+{
+	struct Job
+	{
+		Vector3i position;
+		Chunk* chunk;
+		Work* w;
+	};
+	std::vector<Job> jobs;
+	for (auto it = work.begin(); it != work.end();)
+	{
+		Vector3i const p = World::chunkPosition(it->first);
+		Chunk* const c = world->getChunkO(p);
+		if (!c)
+		{
+			it = work.erase(it); // Unloaded since queued
+			continue;
+		}
+		if (!(removal ? it->second.remove : it->second.add).empty())
+			jobs.push_back(Job{p, c, &it->second});
+		++it;
+	}
+	if (jobs.empty()) return false;
+
+	nThreads = std::max(1u, std::min<unsigned int>(nThreads, jobs.size()));
+	std::vector<Outbox> outs(nThreads);
+	std::atomic<std::size_t> next(0);
+	auto worker = [this, removal, &jobs, &next](Outbox* out)
+	{
+		for (std::size_t i = next++; i < jobs.size(); i = next++)
+		{
+			if (removal)
+				remove(jobs[i].position, *jobs[i].chunk, *jobs[i].w, *out);
+			else
+				propagate(jobs[i].position, *jobs[i].chunk, *jobs[i].w, *out);
+		}
+	};
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < nThreads; ++i)
+		threads.emplace_back(worker, &outs[i]);
+	worker(&outs[0]);
+	for (auto& t: threads)
+		t.join();
+
+	// Hand over the light that crossed into other chunks
+	for (auto const& out: outs)
+		for (auto const& n: out)
+			queue(World::chunkPosition(n.first), n.second, removal);
+	return true;
+}
+void LightEngine::propagate(Vector3i const& position, Chunk& chunk, Work& w,
+                            Outbox& out) const
+{
+	std::vector<Node>& q = w.add;
+	for (std::size_t i = 0; i < q.size(); ++i)
+	{
+		Node const n = q[i];
+		bool const sky = n.flags & FLAG_SKY;
+		int level = lightAt(chunk, n.cell, sky);
+		if (!(n.flags & FLAG_FORCE))
+		{
+			if (n.level <= level || blockAt(chunk, n.cell)->isOpaque())
+				continue;
+			level = n.level;
+			setLight(chunk, n.cell, sky, level);
+		}
+		if (level <= 1) continue;
+
+		for (int d = 0; d < 6; ++d)
+		{
+			int const l = sky && d == dDown && level == levelMax ?
+			              levelMax : level - 1;
+			Vector3i offset;
+			int const cellN = neighbour(n.cell, d, &offset);
+			Node const next{(std::uint16_t) cellN, (std::uint8_t) l,
+			                (std::uint8_t) (n.flags & FLAG_SKY)};
+			if (offset.isZero())
+			{
+				// Skip offers that would be rejected
+				if (l > lightAt(chunk, cellN, sky))
+					q.push_back(next);
+			}
+			else if (World::isValidChunk(position + offset))
+				out.emplace_back(World::chunkKey(position + offset), next);
+		}
+	}
+	q.clear();
+}
+void LightEngine::remove(Vector3i const& position, Chunk& chunk, Work& w,
+                         Outbox& out) const
+{
+	std::vector<Node>& q = w.remove;
+	for (std::size_t i = 0; i < q.size(); ++i)
+	{
+		Node const n = q[i];
+		bool const sky = n.flags & FLAG_SKY;
+		int level = n.level; // Light that was removed from the cell
+		if (!(n.flags & FLAG_FORCE))
+		{
+			int const current = lightAt(chunk, n.cell, sky);
+			if (current == 0) continue;
+			bool const lost = current < n.level ||
+			                  (sky && (n.flags & FLAG_DOWN) &&
+			                   n.level == levelMax && current == levelMax);
+			if (!lost)
+			{
+				// Lit by another source; it relights the darkened cells.
+				w.add.push_back(Node{n.cell, 0,
+				                     (std::uint8_t) (FLAG_FORCE | (n.flags & FLAG_SKY))});
+				continue;
+			}
+			level = current;
+			setLight(chunk, n.cell, sky, 0);
+			int const e = sky ? 0 : blockAt(chunk, n.cell)->getLightEmission();
+			if (e > 0)
+			{
+				chunk.setBlockLight(n.cell, e);
+				w.add.push_back(Node{n.cell, (std::uint8_t) e, FLAG_FORCE});
+			}
+		}
+
+		for (int d = 0; d < 6; ++d)
+		{
+			Vector3i offset;
+			int const cellN = neighbour(n.cell, d, &offset);
+			Node const next{(std::uint16_t) cellN, (std::uint8_t) level,
+			                (std::uint8_t) ((n.flags & FLAG_SKY) |
+			                                (d == dDown ? FLAG_DOWN : 0))};
+			if (offset.isZero())
+				q.push_back(next);
+			else if (World::isValidChunk(position + offset))
+				out.emplace_back(World::chunkKey(position + offset), next);
+		}
+	}
+	q.clear();
+}
+void LightEngine::queue(Vector3i const& position, Node node, bool removal)
+{
+	if (!world->getChunkO(position)) return;
+	Work& w = work[World::chunkKey(position)];
+	(removal ? w.remove : w.add).push_back(node);
+}
+
+} // namespace fab
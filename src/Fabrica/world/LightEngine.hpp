@@ -0,0 +1,108 @@
+#ifndef FABRICA_WORLD_LIGHTENGINE_HPP_
+#define FABRICA_WORLD_LIGHTENGINE_HPP_
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "chunk/Chunk.hpp"
+
+namespace fab
+{
+
+class World;
+
+/**
+ * @brief Propagates sky and block light through the chunks of a
+ *  {@code World}.
+ *
+ * Light levels go from 0 to 15. Opaque blocks do not receive light. Light
+ * decreases by 1 per block, except sky light of level 15, which travels
+ * straight down without loss.
+ *
+ * Changes are queued per chunk and processed by {@code update} with
+ * breadth-first searches: first the removal of light that lost its source,
+ * then the propagation of new light. Only cells whose light changes (and their
+ * neighbours) are visited. Each chunk's queue is processed by one thread at a
+ * time; light crossing into a neighbouring chunk is collected and handed over
+ * at the end of each round, so the chunks of a round can be processed on
+ * several threads.
+ *
+ * Not thread-safe; {@code update} spawns its own threads.
+ */
+class LightEngine final
+{
+public:
+	static constexpr int const levelMax = 15;
+
+	LightEngine(World* const world) noexcept;
+
+	/**
+	 * @brief Recomputes the light of whole chunk columns [x, z] from scratch.
+	 *  Light from loaded neighbouring columns flows in. Sky light is read
+	 *  from the heightmaps of the columns, which must be up to date. Columns
+	 *  that are not loaded are skipped.
+	 */
+	void lightColumns(std::vector<Vector2i> const& columns);
+	/**
+	 * @brief Queues the light update of a block change. The block must already
+	 *  be in the world.
+	 */
+	void onBlockChanged(Vector3i const& position, Block* before, Block* after);
+
+	bool isPending() const noexcept { return !work.empty(); }
+	/**
+	 * @brief Processes all queued updates.
+	 */
+	void update(unsigned int nThreads = 1);
+
+private:
+	enum Flags: std::uint8_t
+	{
+		FLAG_SKY = 1, ///< Sky light, otherwise block light
+		/**
+		 * For propagation: spread the current light of the cell.
+		 * For removal: the cell has been darkened; spread the darkness.
+		 */
+		FLAG_FORCE = 2,
+		FLAG_DOWN = 4, ///< Came from the cell above
+	};
+	/**
+	 * @brief An offer of light (or of darkness for removal) to a cell.
+	 */
+	struct Node
+	{
+		std::uint16_t cell;
+		std::uint8_t level;
+		std::uint8_t flags;
+	};
+	struct Work
+	{
+		std::vector<Node> add;
+		std::vector<Node> remove;
+	};
+	typedef std::vector<std::pair<std::int64_t, Node>> Outbox;
+
+	/**
+	 * @brief Runs one round of removal or propagation over all chunks with
+	 *  queued nodes.
+	 * @return False if there was nothing to do.
+	 */
+	bool round(bool removal, unsigned int nThreads);
+	void propagate(Vector3i const& position, Chunk& chunk, Work& w,
+	               Outbox& out) const;
+	void remove(Vector3i const& position, Chunk& chunk, Work& w,
+	            Outbox& out) const;
+	/**
+	 * @brief Queues a node in the chunk at the given position, if loaded.
+	 */
+	void queue(Vector3i const& position, Node node, bool removal);
+
+	World* world;
+	std::unordered_map<std::int64_t, Work> work;
+};
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_LIGHTENGINE_HPP_
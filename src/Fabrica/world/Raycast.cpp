@@ -0,0 +1,133 @@
+#include "World.hpp"
+
+#include <cmath>
+#include <limits>
+
+#include "ChunkCache.hpp"
+
+namespace fab
+{
+
+namespace
+{
+
+RayHit trace(Ray const& ray, ChunkCache& cache) noexcept
+{
+	RayHit result;
+	result.hit = false;
+	result.position = Vector3i::Zero();
+	result.block = nullptr;
+	result.face = static_cast<Facing3>(0);
+	result.distance = ray.maxDistance;
+
+	float const length = ray.direction.norm();
+	if (!(length > 0.f)) return result;
+	Vector3f const d = ray.direction / length;
+	Vector3f const& o = ray.origin;
+
+	// Face through which a block is entered when stepping in the positive and
+	// negative direction of each axis.
+	static Facing3 const facesPos[3] =
+	  {Facing3::West, Facing3::Down, Facing3::North};
+	static Facing3 const facesNeg[3] =
+	  {Facing3::East, Facing3::Up, Facing3::South};
+
+	Vector3i block((int) std::floor(o.x()),
+	               (int) std::floor(o.y()),
+	               (int) std::floor(o.z()));
+	int step[3];
+	float tMax[3]; // Distance at which the next block boundary is crossed
+	float tDelta[3]; // Distance between block boundaries
+	for (int a = 0; a < 3; ++a)
+	{
+		if (d[a] > 0.f)
+		{
+			step[a] = 1;
+			tDelta[a] = 1.f / d[a];
+			tMax[a] = (block[a] + 1 - o[a]) * tDelta[a];
+		}
+		else if (d[a] < 0.f)
+		{
+			step[a] = -1;
+			tDelta[a] = -1.f / d[a];
+			tMax[a] = (o[a] - block[a]) * tDelta[a];
+		}
+		else
+		{
+			step[a] = 0;
+			tDelta[a] = tMax[a] = std::numeric_limits<float>::infinity();
+		}
+	}
+
+	// The chunk is resolved again only when the ray crosses into another.
+	Vector3i chunkPos(divide_floor(block.x(), Chunk::size),
+	                  divide_floor(block.y(), Chunk::size),
+	                  divide_floor(block.z(), Chunk::size));
+	Vector3i local = block - Chunk::size * chunkPos;
+	ChunkIn* chunk = World::isValidChunk(chunkPos) ? cache.get(chunkPos) : nullptr;
+
+	float t = 0.f;
+	Facing3 face = static_cast<Facing3>(0);
+	for (;;)
+	{
+		if (chunkPos.x() < -World::chunkXMax ||
+		    chunkPos.x() >= World::chunkXMax ||
+		    chunkPos.z() < -World::chunkZMax ||
+		    chunkPos.z() >= World::chunkZMax)
+			return result;
+		if (chunkPos.y() < 0)
+		{
+			if (step[1] <= 0) return result;
+		}
+		else if (chunkPos.y() >= World::chunkYMax)
+		{
+			if (step[1] >= 0) return result;
+		}
+		else
+		{
+			if (!chunk) return result;
+			Block* const b = chunk->getBlock(local);
+			if (b != &BlockNull::instance)
+			{
+				result.hit = true;
+				result.position = block;
+				result.block = b;
+				result.face = face;
+				result.distance = t;
+				return result;
+			}
+		}
+
+		int const a = tMax[0] < tMax[1] ?
+		              (tMax[0] < tMax[2] ? 0 : 2) :
+		              (tMax[1] < tMax[2] ? 1 : 2);
+		if (tMax[a] > ray.maxDistance) return result;
+		t = tMax[a];
+		tMax[a] += tDelta[a];
+		block[a] += step[a];
+		local[a] += step[a];
+		face = step[a] > 0 ? facesPos[a] : facesNeg[a];
+		if (local[a] < 0 || local[a] >= Chunk::size)
+		{
+			local[a] -= step[a] * Chunk::size;
+			chunkPos[a] += step[a];
+			chunk = World::isValidChunk(chunkPos) ?
+			        cache.get(chunkPos) : nullptr;
+		}
+	}
+}
+
+} // namespace
+
+RayHit World::raycast(Ray const& ray) const noexcept
+{
+	ChunkCache cache(*this);
+	return trace(ray, cache);
+}
+void World::raycast(Ray const* rays, RayHit* hits, std::size_t n,
+                    unsigned int nThreads) const
+{
+	queryBatch(*this, rays, hits, n, nThreads, trace);
+}
+
+} // namespace fab
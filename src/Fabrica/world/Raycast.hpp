@@ -0,0 +1,39 @@
+#ifndef FABRICA_WORLD_RAYCAST_HPP_
+#define FABRICA_WORLD_RAYCAST_HPP_
+
+#include "../block/Block.hpp"
+#include "../util/facing.hpp"
+#include "../util/vector.hpp"
+
+namespace fab
+{
+
+/**
+ * @brief A ray traced by {@code World::raycast}.
+ */
+struct Ray
+{
+	Vector3f origin;
+	Vector3f direction; ///< Need not be normalised
+	float maxDistance;
+};
+
+/**
+ * @brief Result of {@code World::raycast}.
+ */
+struct RayHit
+{
+	bool hit;
+	Vector3i position; ///< Position of the block hit
+	Block* block;
+	/**
+	 * Face of the block through which the ray entered. Empty if the ray starts
+	 * inside the block.
+	 */
+	Facing3 face;
+	float distance; ///< Distance from the origin to the entry point
+};
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_RAYCAST_HPP_
@@ -0,0 +1,301 @@
+#include "RegionFile.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fab
+{
+
+namespace
+{
+
+char const magicRegion[4] = {'F', 'A', 'B', 'R'};
+std::uint32_t const versionRegion = 1;
+
+bool writeAll(int fd, char const* data, std::size_t size, off_t offset)
+{
+	while (size > 0)
+	{
+		ssize_t n = ::pwrite(fd, data, size, offset);
+		if (n < 0) return false;
+		data += n;
+		size -= n;
+		offset += n;
+	}
+	return true;
+}
+/**
+ * Makes a rename in the directory durable.
+ */
+bool syncDirectory(boost::filesystem::path const& dir)
+{
+	int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	bool result = ::fsync(fd) == 0;
+	::close(fd);
+	return result;
+}
+
+} // namespace
+
+constexpr int const RegionFile::width;
+constexpr std::size_t const RegionFile::sectorSize;
+
+RegionFile::RegionFile(boost::filesystem::path file, int nSections):
+	file(file), nSections(nSections), nSlots(width * width * nSections),
+	fd(-1), mapping(nullptr), mappingSize(0),
+	generation(0), fileSectors(0), liveSectors(0)
+{
+}
+RegionFile::~RegionFile()
+{
+	close();
+}
+
+bool RegionFile::open()
+{
+	assert(!isOpen() && "class RegionFile: Already open");
+
+	boost::filesystem::path const tmp = file.string() + ".tmp";
+	boost::system::error_code ec;
+	boost::filesystem::remove(tmp, ec); // Left over by an interrupted rewrite
+
+	if (!boost::filesystem::exists(file))
+	{
+		// Create through a rename so that a crash cannot leave a file without
+		// a valid header.
+		int t = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (t < 0) return false;
+		bool ok = ::ftruncate(t, 2 * headerSectors() * sectorSize) == 0 &&
+		          writeHeader(t, 1, std::vector<Entry>(nSlots, Entry{0, 0})) &&
+		          ::fsync(t) == 0;
+		::close(t);
+		if (!ok ||
+		    std::rename(tmp.c_str(), file.c_str()) != 0 ||
+		    !syncDirectory(file.parent_path()))
+			return false;
+	}
+
+	fd = ::open(file.c_str(), O_RDWR);
+	if (fd < 0) return false;
+	if (!map())
+	{
+		close();
+		return false;
+	}
+
+	// Pick the valid header with the highest generation
+	std::size_t const headerSize = headerSectors() * sectorSize;
+	if (mappingSize < 2 * headerSize)
+	{
+		close();
+		return false;
+	}
+	generation = 0;
+	for (int i = 0; i < 2; ++i)
+	{
+		char const* base = mapping + i * headerSize;
+		Header h;
+		std::memcpy(&h, base, sizeof(Header));
+		if (std::memcmp(h.magic, magicRegion, 4) ||
+		    h.version != versionRegion ||
+		    h.nSlots != (std::uint32_t) nSlots ||
+		    h.generation <= generation)
+			continue;
+		std::vector<Entry> t(nSlots);
+		std::memcpy(t.data(), base + sizeof(Header), nSlots * sizeof(Entry));
+		if (checksum(t) != h.checksum)
+			continue;
+		generation = h.generation;
+		table = std::move(t);
+	}
+	if (generation == 0)
+	{
+		close();
+		return false;
+	}
+
+	// Records beyond the end of the file are lost
+	liveSectors = 0;
+	for (auto& e: table)
+	{
+		if (e.length == 0) continue;
+		if (e.sector < 2 * headerSectors() ||
+		    e.sector + sectorsOf(e.length) > fileSectors)
+		{
+			e = Entry{0, 0};
+			continue;
+		}
+		liveSectors += sectorsOf(e.length);
+	}
+	return true;
+}
+
+std::pair<char const*, std::size_t>
+RegionFile::read(int slot) const noexcept
+{
+	assert(0 <= slot && slot < nSlots);
+	Entry const& e = table[slot];
+	if (e.length == 0 || !mapping)
+		return std::make_pair(nullptr, 0);
+	return std::make_pair(mapping + e.sector * sectorSize, e.length);
+}
+
+bool RegionFile::commit(std::vector<std::pair<int, std::string>> const& records)
+{
+	assert(isOpen() && "class RegionFile: Not open");
+	if (records.empty()) return true;
+
+	// Append all records in one write
+	std::vector<Entry> t = table;
+	std::string buffer;
+	for (auto const& r: records)
+	{
+		assert(0 <= r.first && r.first < nSlots);
+		if (r.second.empty())
+		{
+			t[r.first] = Entry{0, 0};
+			continue;
+		}
+		std::size_t const sector = fileSectors + buffer.size() / sectorSize;
+		t[r.first] = Entry{(std::uint32_t) sector,
+		                   (std::uint32_t) r.second.size()};
+		buffer += r.second;
+		buffer.resize(sectorsOf(buffer.size()) * sectorSize, '\0');
+	}
+	if (!writeAll(fd, buffer.data(), buffer.size(), fileSectors * sectorSize) ||
+	    ::fdatasync(fd) != 0)
+		return false;
+	// The records are durable; publish them.
+	if (!writeHeader(fd, generation + 1, t))
+		return false;
+
+	++generation;
+	table = std::move(t);
+	fileSectors += buffer.size() / sectorSize;
+	liveSectors = 0;
+	for (auto const& e: table)
+		liveSectors += sectorsOf(e.length);
+
+	// The records are stored even if they cannot be mapped; the file then
+	// needs to be opened again.
+	unmap();
+	if (!map())
+		close();
+	return true;
+}
+bool RegionFile::shouldCompact() const noexcept
+{
+	// Reclaim space once most of the file is garbage
+	std::size_t const dataSectors = fileSectors - 2 * headerSectors();
+	return dataSectors > 256 && dataSectors > 2 * liveSectors;
+}
+bool RegionFile::compact()
+{
+	assert(isOpen() && "class RegionFile: Not open");
+
+	boost::filesystem::path const tmp = file.string() + ".tmp";
+	int t = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (t < 0) return false;
+
+	std::vector<Entry> packed(nSlots, Entry{0, 0});
+	std::string buffer;
+	std::size_t const begin = 2 * headerSectors();
+	for (int i = 0; i < nSlots; ++i)
+	{
+		Entry const& e = table[i];
+		if (e.length == 0) continue;
+		packed[i] = Entry{(std::uint32_t) (begin + buffer.size() / sectorSize),
+		                  e.length};
+		buffer.append(mapping + e.sector * sectorSize, e.length);
+		buffer.resize(sectorsOf(buffer.size()) * sectorSize, '\0');
+	}
+	bool ok = ::ftruncate(t, begin * sectorSize + buffer.size()) == 0 &&
+	          writeAll(t, buffer.data(), buffer.size(), begin * sectorSize) &&
+	          writeHeader(t, generation + 1, packed) &&
+	          ::fsync(t) == 0;
+	::close(t);
+	if (!ok)
+	{
+		::unlink(tmp.c_str());
+		return false;
+	}
+
+	// The mapping keeps the original readable until it is replaced.
+	if (std::rename(tmp.c_str(), file.c_str()) != 0)
+	{
+		::unlink(tmp.c_str());
+		return false;
+	}
+	// Either file is valid, so the region is reopened even if the rename is
+	// not durable yet.
+	bool const synced = syncDirectory(file.parent_path());
+	close();
+	return open() && synced;
+}
+
+bool RegionFile::writeHeader(int out, std::uint64_t g,
+                             std::vector<Entry> const& t)
+{
+	std::string buffer(headerSectors() * sectorSize, '\0');
+	Header h;
+	std::memcpy(h.magic, magicRegion, 4);
+	h.version = versionRegion;
+	h.generation = g;
+	h.checksum = checksum(t);
+	h.nSlots = nSlots;
+	std::memcpy(&buffer[0], &h, sizeof(Header));
+	std::memcpy(&buffer[sizeof(Header)], t.data(), nSlots * sizeof(Entry));
+
+	return writeAll(out, buffer.data(), buffer.size(),
+	                (g % 2) * buffer.size()) &&
+	       ::fdatasync(out) == 0;
+}
+bool RegionFile::map()
+{
+	struct stat s;
+	if (::fstat(fd, &s) != 0) return false;
+	mappingSize = s.st_size;
+	fileSectors = sectorsOf(mappingSize);
+	if (mappingSize == 0) return true;
+
+	void* p = ::mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+	{
+		mappingSize = 0;
+		return false;
+	}
+	mapping = static_cast<char*>(p);
+	return true;
+}
+void RegionFile::unmap() noexcept
+{
+	if (mapping)
+		::munmap(mapping, mappingSize);
+	mapping = nullptr;
+	mappingSize = 0;
+}
+void RegionFile::close() noexcept
+{
+	unmap();
+	if (fd >= 0)
+		::close(fd);
+	fd = -1;
+}
+std::uint32_t
+RegionFile::checksum(std::vector<Entry> const& t) const noexcept
+{
+	std::uint32_t h = 2166136261u; // FNV-1a
+	char const* p = reinterpret_cast<char const*>(t.data());
+	for (std::size_t i = 0; i < t.size() * sizeof(Entry); ++i)
+		h = (h ^ (unsigned char) p[i]) * 16777619u;
+	return h;
+}
+
+} // namespace fab
@@ -0,0 +1,147 @@
+#ifndef FABRICA_WORLD_REGIONFILE_HPP_
+#define FABRICA_WORLD_REGIONFILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+
+namespace fab
+{
+
+/**
+ * @brief A file storing the chunks of 32x32 chunk columns.
+ *
+ * Layout, in 4096 byte sectors:
+ *
+ * 	[Header A][Header B][Records...]
+ *
+ * Each header holds a generation number, a checksum and an offset table with
+ * one {sector, length} entry per chunk slot. The valid header with the highest
+ * generation is current. Every record starts on a sector boundary, so reading
+ * one chunk touches only its own pages.
+ *
+ * The file is memory-mapped for reads. Writes are crash-safe:
+ * - {@code commit} appends the records after the end of the file, syncs them
+ *   and then writes the new offset table into the header that is not current.
+ *   A crash before the header is synced leaves the previous header valid.
+ * - {@code compact} rewrites the live records into a temporary file and
+ *   renames it over the region file.
+ *
+ * Uses POSIX file I/O. Not thread-safe.
+ */
+class RegionFile final: boost::noncopyable
+{
+public:
+	static constexpr int const width = 32; ///< Columns along x and z
+	static constexpr std::size_t const sectorSize = 4096;
+
+	/**
+	 * @param[in] nSections Chunk slots per column.
+	 */
+	RegionFile(boost::filesystem::path file, int nSections);
+	~RegionFile();
+
+	/**
+	 * @brief Opens the file, creating it if it does not exist.
+	 * @return False if the file cannot be created or has no valid header.
+	 */
+	bool open();
+	bool isOpen() const noexcept { return fd >= 0; }
+
+	int getNSlots() const noexcept { return nSlots; }
+	/**
+	 * @brief Index of the slot of a chunk.
+	 * @param[in] x, z Column coordinates within the region, in [0, width).
+	 * @param[in] y Section, in [0, nSections).
+	 */
+	int slot(int x, int y, int z) const noexcept
+	{
+		return (x * width + z) * nSections + y;
+	}
+
+	/**
+	 * @brief Gets a record without copying it.
+	 * @return Pointer into the mapped file and the length of the record, or
+	 *  {nullptr, 0} if the slot is empty or the file is not mapped.
+	 *  Invalidated by {@code commit} and {@code compact}.
+	 */
+	std::pair<char const*, std::size_t> read(int slot) const noexcept;
+
+	/**
+	 * @brief Durably stores a batch of records, replacing the previous
+	 *  records of their slots.
+	 * @param[in] records {slot, data} pairs. Empty data clears the slot.
+	 * @return True once the records are durable, even if the file could not
+	 *  be mapped again and had to be closed.
+	 */
+	bool commit(std::vector<std::pair<int, std::string>> const& records);
+	/**
+	 * @brief True once most of the file is garbage.
+	 */
+	bool shouldCompact() const noexcept;
+	/**
+	 * @brief Rewrites the file with only the live records.
+	 * @return False on failure. The region is then open on the original file,
+	 *  or closed if the rewritten file cannot be opened.
+	 */
+	bool compact();
+
+	std::size_t getLiveSectors() const noexcept { return liveSectors; }
+	std::size_t getFileSectors() const noexcept { return fileSectors; }
+
+private:
+	struct Entry
+	{
+		std::uint32_t sector;
+		std::uint32_t length; ///< In bytes, 0 if empty
+	};
+	struct Header
+	{
+		char magic[4];
+		std::uint32_t version;
+		std::uint64_t generation;
+		std::uint32_t checksum; ///< Of the offset table
+		std::uint32_t nSlots;
+	};
+
+	static std::size_t sectorsOf(std::size_t bytes) noexcept
+	{
+		return (bytes + sectorSize - 1) / sectorSize;
+	}
+	std::size_t headerSectors() const noexcept
+	{
+		return sectorsOf(sizeof(Header) + nSlots * sizeof(Entry));
+	}
+
+	/**
+	 * @brief Writes header number {@code generation % 2} to out and syncs it.
+	 */
+	bool writeHeader(int out, std::uint64_t generation,
+	                 std::vector<Entry> const& t);
+	bool map();
+	void unmap() noexcept;
+	void close() noexcept;
+	std::uint32_t checksum(std::vector<Entry> const&) const noexcept;
+
+	boost::filesystem::path file;
+	int nSections;
+	int nSlots;
+
+	int fd;
+	char* mapping;
+	std::size_t mappingSize;
+
+	std::uint64_t generation;
+	std::vector<Entry> table;
+	std::size_t fileSectors;
+	std::size_t liveSectors;
+};
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_REGIONFILE_HPP_
@@ -1,6 +1,224 @@
 #include "Universe.hpp"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../util/integers.hpp"
+
 namespace fab
 {
 
+namespace
+{
+
+/// Queued bytes above which saveChunk flushes.
+std::size_t const queueBytesMax = 8 << 20;
+
+} // namespace
+
+Universe::Universe(boost::filesystem::path directory,
+                   std::map<std::string, Block*> const& blocks):
+	logger(LogManager::create("UNIVERSE")),
+	directory(directory),
+	blocksRegistered(blocks),
+	queueBytes(0)
+{
+}
+Universe::~Universe()
+{
+	flush();
+}
+
+bool Universe::open()
+{
+	namespace bfs = boost::filesystem;
+
+	boost::system::error_code ec;
+	bfs::create_directories(directory / "region", ec);
+	if (ec)
+	{
+		logger.error("Unable to create save " + directory.string());
+		return false;
+	}
+
+	// Ids already assigned by the save keep their blocks. Names of blocks that
+	// are no longer registered are kept so that their Ids stay reserved.
+	std::vector<std::string> names(1);
+	{
+		std::ifstream file((directory / "blocks.txt").string());
+		std::string name;
+		while (std::getline(file, name))
+			names.push_back(name);
+	}
+	std::vector<Block*> blocks(1, &BlockNull::instance);
+	for (std::size_t i = 1; i < names.size(); ++i)
+	{
+		auto it = blocksRegistered.find(names[i]);
+		if (it == blocksRegistered.end())
+		{
+			logger.warn("Block " + names[i] + " is not registered."
+			            " Replaced by air.");
+			blocks.push_back(nullptr);
+			continue;
+		}
+		blocks.push_back(it->second);
+	}
+	bool changed = false;
+	for (auto const& b: blocksRegistered)
+	{
+		if (std::find(blocks.begin(), blocks.end(), b.second) != blocks.end())
+			continue;
+		blocks.push_back(b.second);
+		names.push_back(b.first);
+		changed = true;
+	}
+	codec.setBlocks(blocks);
+	if (!changed) return true;
+
+	bfs::path const p = directory / "blocks.txt";
+	bfs::path const tmp = directory / "blocks.txt.tmp";
+	{
+		std::ofstream file(tmp.string(), std::ios::trunc);
+		for (std::size_t i = 1; i < names.size(); ++i)
+			file << names[i] << '\n';
+		file.flush();
+		if (!file)
+		{
+			logger.error("Unable to write " + tmp.string());
+			return false;
+		}
+	}
+	{
+		// The region files depend on the Ids, so they must be durable.
+		int fd = ::open(tmp.c_str(), O_RDONLY);
+		if (fd >= 0)
+		{
+			::fsync(fd);
+			::close(fd);
+		}
+	}
+	if (std::rename(tmp.c_str(), p.c_str()) != 0)
+	{
+		logger.error("Unable to write " + p.string());
+		return false;
+	}
+	return true;
+}
+void Universe::attach(World& world)
+{
+	world.setSaver([this](Vector3i const& p, ChunkIn& c)
+	{
+		return saveChunk(p, c);
+	});
+	world.setLoader([this](Vector3i const& p, Chunk& c)
+	{
+		return loadChunk(p, c);
+	});
+}
+
+bool Universe::saveChunk(Vector3i const& position, ChunkIn& chunk)
+{
+	int slot;
+	RegionFile* rf = region(position, &slot);
+	if (!rf) return false;
+
+	RegionId const id(divide_floor(position.x(), RegionFile::width),
+	                  divide_floor(position.z(), RegionFile::width));
+	std::string& record = queue[id][slot];
+	queueBytes -= record.size();
+	codec.encode(chunk, record);
+	queueBytes += record.size();
+
+	if (queueBytes > queueBytesMax)
+		return flush();
+	return true;
+}
+bool Universe::loadChunk(Vector3i const& position, Chunk& chunk)
+{
+	int slot;
+	RegionFile* rf = region(position, &slot);
+	if (!rf) return false;
+
+	RegionId const id(divide_floor(position.x(), RegionFile::width),
+	                  divide_floor(position.z(), RegionFile::width));
+	auto q = queue.find(id);
+	if (q != queue.end())
+	{
+		auto it = q->second.find(slot);
+		if (it != q->second.end())
+			return codec.decode(it->second.data(), it->second.size(), chunk);
+	}
+	auto record = rf->read(slot);
+	return record.first &&
+	       codec.decode(record.first, record.second, chunk);
+}
+bool Universe::flush()
+{
+	bool result = true;
+	for (auto it = queue.begin(); it != queue.end();)
+	{
+		std::vector<std::pair<int, std::string>> records;
+		std::size_t bytes = 0;
+		for (auto& r: it->second)
+		{
+			bytes += r.second.size();
+			records.emplace_back(r.first, std::move(r.second));
+		}
+		RegionFile* rf = region(it->first);
+		if (rf && rf->commit(records))
+		{
+			// Best effort: the records are stored either way.
+			if (rf->isOpen() && rf->shouldCompact() && !rf->compact())
+				logger.warn("Unable to compact region [" +
+				            std::to_string(it->first.first) + ", " +
+				            std::to_string(it->first.second) + "]");
+			queueBytes -= bytes;
+			it = queue.erase(it);
+			continue;
+		}
+		// Keep the chunks queued
+		for (auto& r: records)
+			it->second[r.first] = std::move(r.second);
+		logger.error("Unable to write region [" +
+		             std::to_string(it->first.first) + ", " +
+		             std::to_string(it->first.second) + "]");
+		result = false;
+		++it;
+	}
+	return result;
+}
+
+RegionFile* Universe::region(RegionId const& id)
+{
+	std::unique_ptr<RegionFile>& rf = regions[id];
+	std::string const name = "r." + std::to_string(id.first) + "." +
+	                         std::to_string(id.second) + ".fr";
+	if (!rf)
+		rf.reset(new RegionFile(directory / "region" / name, World::chunkYMax));
+	// Also reopens a region closed by a failed compaction
+	if (!rf->isOpen() && !rf->open())
+	{
+		logger.error("Unable to open region " + name);
+		rf.reset();
+		return nullptr;
+	}
+	return rf.get();
+}
+RegionFile* Universe::region(Vector3i const& position, int* slot)
+{
+	RegionId const id(divide_floor(position.x(), RegionFile::width),
+	                  divide_floor(position.z(), RegionFile::width));
+	RegionFile* rf = region(id);
+	if (!rf) return nullptr;
+	*slot = rf->slot(modulo_floor(position.x(), RegionFile::width),
+	                 position.y(),
+	                 modulo_floor(position.z(), RegionFile::width));
+	return rf;
+}
+
 } // namespace fab
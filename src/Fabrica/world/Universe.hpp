@@ -1,6 +1,21 @@
 #ifndef FABRICA_WORLD_UNIVERSE_HPP_
 #define FABRICA_WORLD_UNIVERSE_HPP_
 
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/core/noncopyable.hpp>
+#include <boost/filesystem.hpp>
+
+#include "RegionFile.hpp"
+#include "World.hpp"
+#include "chunk/ChunkCodec.hpp"
+#include "../common/LogManager.hpp"
+
 namespace fab
 {
 
@@ -11,9 +26,83 @@ namespace fab
  *	A map from block Id to blocks
  *	A list of worlds "Dimensions"
  *
+ * Directory layout:
+ *	blocks.txt: Names of the blocks with Id 1, 2, ... one per line. Id 0 is
+ *		{@code BlockNull}.
+ *	region/r.<x>.<z>.fr: {@code RegionFile} of the 32x32 columns starting at
+ *		chunk column [32x, 32z].
+ *
+ * Saved chunks are queued and written to the region files by {@code flush}.
+ * Not thread-safe.
  */
-class Universe final
+class Universe final: boost::noncopyable
 {
+public:
+	/**
+	 * @param[in] blocks Registered blocks by name, for assigning Ids.
+	 */
+	Universe(boost::filesystem::path directory,
+	         std::map<std::string, Block*> const& blocks);
+	/**
+	 * @brief Flushes the queued chunks.
+	 */
+	~Universe();
+
+	/**
+	 * @brief Creates the save if it does not exist and loads the block Ids.
+	 * @return False if the save cannot be read or created.
+	 */
+	bool open();
+
+	/**
+	 * @brief Makes the world save and load its chunks through this universe.
+	 */
+	void attach(World& world);
+
+	/**
+	 * @brief Codec of the chunks of this universe, which holds the block Ids.
+	 */
+	ChunkCodec const& getCodec() const noexcept { return codec; }
+
+	/**
+	 * @brief Queues a chunk to be saved.
+	 */
+	bool saveChunk(Vector3i const& position, ChunkIn& chunk);
+	/**
+	 * @brief Reads a chunk, either from the queue or from its region file.
+	 * @return False if the chunk is not saved.
+	 */
+	bool loadChunk(Vector3i const& position, Chunk& chunk);
+	/**
+	 * @brief Durably writes the queued chunks.
+	 */
+	bool flush();
+
+private:
+	typedef std::pair<int, int> RegionId;
+
+	/**
+	 * @brief Gets a region file, opening it if needed.
+	 * @return nullptr if the file cannot be opened.
+	 */
+	RegionFile* region(RegionId const& id);
+	/**
+	 * @brief Gets the region file containing a chunk, opening it if needed.
+	 * @param[out] slot Slot of the chunk in the region file.
+	 * @return nullptr if the file cannot be opened.
+	 */
+	RegionFile* region(Vector3i const& position, int* slot);
+
+	Logger logger;
+	boost::filesystem::path directory;
+	std::map<std::string, Block*> blocksRegistered;
+
+	ChunkCodec codec;
+
+	std::map<RegionId, std::unique_ptr<RegionFile>> regions;
+	/// Chunks waiting to be written, by region and slot.
+	std::map<RegionId, std::map<int, std::string>> queue;
+	std::size_t queueBytes;
 };
 
 } // namespace fab
@@ -1,16 +1,215 @@
 #include "World.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
 #include "../core/Fabrica.hpp"
 
 namespace fab
 {
 
-World::World()
+World::World(std::uint32_t seed):
+	generator(seed, &Fabrica::blockGrass),
+	light(this)
+{
+}
+
+void World::loadColumns(std::vector<Vector2i> const& positions,
+                        unsigned int nThreads)
+{
+	std::vector<std::unique_ptr<ChunkColumn>> loaded;
+	std::vector<std::size_t> pending; // Indices in loaded, to be generated
+	std::vector<std::uint32_t> stored; // Mask of the sections loaded
+	for (auto const& c: positions)
+	{
+		if (c.x() < -chunkXMax || c.x() >= chunkXMax ||
+		    c.y() < -chunkZMax || c.y() >= chunkZMax)
+			continue;
+		std::int64_t const key = columnKey(c);
+		if (columns.count(key))
+		{
+			residency.onHit(key);
+			continue;
+		}
+		if (std::any_of(loaded.begin(), loaded.end(),
+		                [&c](std::unique_ptr<ChunkColumn> const& l)
+		                {
+			                return l->getPosition() == c;
+		                }))
+			continue; // Requested twice
+
+		std::unique_ptr<ChunkColumn> column(new ChunkColumn(c));
+		std::uint32_t mask = 0;
+		for (int y = 0; y < chunkYMax && loader; ++y)
+		{
+			Chunk& section = column->getSection(y);
+			if (loader(Vector3i(c.x(), y, c.y()), section))
+			{
+				section.setDirty(false);
+				mask |= 1u << y;
+			}
+		}
+		if (mask != (1u << chunkYMax) - 1)
+		{
+			pending.push_back(loaded.size());
+			stored.push_back(mask);
+		}
+		loaded.push_back(std::move(column));
+	}
+
+	// Each thread takes the next column until all are generated. Columns
+	// without stored sections are generated in place; otherwise the sections
+	// are generated aside and only the missing ones are kept.
+	std::atomic<std::size_t> next(0);
+	auto worker = [this, &next, &pending, &stored, &loaded]()
+	{
+		std::unique_ptr<ChunkColumn> aside;
+		for (std::size_t i = next++; i < pending.size(); i = next++)
+		{
+			ChunkColumn& column = *loaded[pending[i]];
+			Vector2i const& c = column.getPosition();
+			if (stored[i] && !aside)
+				aside.reset(new ChunkColumn(c));
+			ChunkColumn& target = stored[i] ? *aside : column;
+			Chunk* sections[chunkYMax];
+			for (int y = 0; y < chunkYMax; ++y)
+				sections[y] = &target.getSection(y);
+			generator.generateColumn(c.x(), c.y(), sections, chunkYMax);
+			for (int y = 0; y < chunkYMax; ++y)
+			{
+				if (stored[i] & (1u << y)) continue;
+				if (stored[i])
+					column.getSection(y) = target.getSection(y);
+				// Generated sections can be regenerated, so they are clean.
+				column.getSection(y).setDirty(false);
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < nThreads; ++i)
+		threads.emplace_back(worker);
+	worker();
+	for (auto& t: threads)
+		t.join();
+
+	std::vector<Vector2i> changed; // To be lit
+	for (auto& column: loaded)
+	{
+		Vector2i const c = column->getPosition();
+		std::int64_t const key = columnKey(c);
+		column->getHeightmap().compute(*column);
+		residency.countMiss();
+		residency.onLoad(key, c, column->bytes());
+		columns[key] = std::move(column);
+		journalColumn(c);
+		changed.push_back(c);
+	}
+	light.lightColumns(changed);
+	light.update(nThreads);
+}
+bool World::setBlock(Vector3i const& p, Block* const block)
+{
+	Vector3i const pChunk(divide_floor(p.x(), Chunk::size),
+	                      divide_floor(p.y(), Chunk::size),
+	                      divide_floor(p.z(), Chunk::size));
+	if (!isValidChunk(pChunk)) return false;
+	ChunkColumn* const column = getColumnO(Vector2i(pChunk.x(), pChunk.z()));
+	if (!column) return false;
+	Chunk& chunk = column->getSection(pChunk.y());
+
+	Vector3i const pLocal(modulo_floor(p.x(), Chunk::size),
+	                      modulo_floor(p.y(), Chunk::size),
+	                      modulo_floor(p.z(), Chunk::size));
+	Block* const before = chunk.getBlock(pLocal);
+	if (before == block) return true;
+	chunk.setBlock(pLocal, block);
+	column->getHeightmap().onBlockChanged(*column, pLocal.x(), p.y(),
+	                                      pLocal.z(), block);
+	{
+		std::lock_guard<std::mutex> guard(mutexLight);
+		light.onBlockChanged(p, before, block);
+	}
+	journal.append(p, before, block);
+	return true;
+}
+void World::loadSpawn()
+{
+	std::vector<Vector2i> spawn;
+	for (int x = -1; x <= 1; ++x)
+		for (int z = -1; z <= 1; ++z)
+			spawn.push_back(Vector2i(x, z));
+	loadColumns(spawn);
+}
+std::size_t World::saveAll()
+{
+	if (!saver) return 0;
+
+	std::size_t nSaved = 0;
+	for (auto& c: columns)
+		nSaved += saveColumn(*c.second);
+	return nSaved;
+}
+void World::touchColumns(Vector2i const& centre, int radius) noexcept
+{
+	for (int x = centre.x() - radius + 1; x < centre.x() + radius; ++x)
+		for (int z = centre.y() - radius + 1; z < centre.y() + radius; ++z)
+			if (-chunkXMax <= x && x < chunkXMax &&
+			    -chunkZMax <= z && z < chunkZMax)
+				residency.onUse(columnKey(Vector2i(x, z)));
+}
+std::size_t World::evict(Vector2i const& centre, int radius)
+{
+	if (!residency.overBudget()) return 0;
+
+	auto evictable = [&](Vector2i const& p)
+	{
+		if (std::abs(p.x() - centre.x()) < radius &&
+		    std::abs(p.y() - centre.y()) < radius)
+			return false; // In range
+		return saver || !columns.at(columnKey(p))->isDirty();
+	};
+
+	std::size_t nEvicted = 0;
+	for (std::int64_t const key: residency.selectVictims(evictable))
+	{
+		auto it = columns.find(key);
+		ChunkColumn& column = *it->second;
+		if (column.isDirty())
+		{
+			std::size_t const nSaved = saveColumn(column);
+			for (std::size_t i = 0; i < nSaved; ++i)
+				residency.countSave();
+			if (column.isDirty())
+				continue;
+		}
+		residency.onUnload(key);
+		residency.countEviction();
+		journalColumn(column.getPosition());
+		columns.erase(it);
+		++nEvicted;
+	}
+	return nEvicted;
+}
+void World::journalColumn(Vector2i const& position) noexcept
+{
+	for (int y = 0; y < chunkYMax; ++y)
+		journal.appendChunk(Vector3i(position.x(), y, position.y()));
+}
+std::size_t World::saveColumn(ChunkColumn& column)
 {
-	for (int i = 0; i < Chunk::size; ++i)
-		for (int j = 0; j < Chunk::size; ++j)
-			for (int k = 0; k < Chunk::size; ++k)
-				fillChunk.setBlock(Vector3i(i,j,k), &Fabrica::blockGrass);
+	Vector2i const& c = column.getPosition();
+	std::size_t nSaved = 0;
+	for (int y = 0; y < chunkYMax; ++y)
+	{
+		Chunk& section = column.getSection(y);
+		if (!section.isDirty()) continue;
+		if (!saver(Vector3i(c.x(), y, c.y()), section)) continue;
+		section.setDirty(false);
+		++nSaved;
+	}
+	return nSaved;
 }
 
 } // namespace fab
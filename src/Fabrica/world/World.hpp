@@ -1,12 +1,47 @@
 #ifndef FABRICA_WORLD_WORLD_HPP_
 #define FABRICA_WORLD_WORLD_HPP_
 
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BlockJournal.hpp"
+#include "ChunkResidency.hpp"
+#include "Collision.hpp"
+#include "Heightmap.hpp"
+#include "LightEngine.hpp"
+#include "Raycast.hpp"
+#include "WorldLocks.hpp"
 #include "chunk/Chunk.hpp"
+#include "chunk/ChunkColumn.hpp"
+#include "gen/TerrainGenerator.hpp"
 #include "../util/integers.hpp"
 
 namespace fab
 {
 
+/**
+ * @brief The chunks of one dimension.
+ *
+ * Chunks are grouped into {@code ChunkColumn}s, which are loaded, saved and
+ * evicted as a whole.
+ *
+ * Concurrent access is coordinated by the locks of {@code getLocks}, which the
+ * callers take:
+ *	Reading blocks (getChunkO, getBlockO, raycast, sweep, slide, count,
+ *		findNearest): a READ region lock on the chunks read.
+ *	saveAll: a READ region lock on all chunks, from one thread at a time.
+ *	setBlock: a WRITE region lock on the chunk and its neighbours.
+ *	Anything else, including updateLight, fill and replace: a
+ *		{@code WorldLocks::Exclusive} lock, since lighting spreads across
+ *		regions.
+ * A single thread may use the world without locks.
+ */
 class World final
 {
 public:
@@ -18,9 +53,20 @@ public:
 	 */
 	static constexpr int chunkXMax = 256;
 	static constexpr int chunkZMax = 256;
-	static constexpr int chunkYMax = 16;
+	static constexpr int chunkYMax = ChunkColumn::height;
 
-	World();
+	/**
+	 * @brief Saves a dirty chunk before it is evicted. Returns false if the
+	 *  chunk could not be saved, in which case it stays resident.
+	 */
+	typedef std::function<bool (Vector3i const&, ChunkIn&)> ChunkSaver;
+	/**
+	 * @brief Fills a chunk from storage. Returns false if the chunk is not
+	 *  stored, in which case it is generated.
+	 */
+	typedef std::function<bool (Vector3i const&, Chunk&)> ChunkLoader;
+
+	World(std::uint32_t seed = 0);
 
 	/**
 	 * @brief Gets the chunk at the given position.
@@ -29,11 +75,232 @@ public:
 	 * returns nullptr.
 	 */
 	ChunkIn* getChunkO(Vector3i const& position) const noexcept;
+	Chunk* getChunkO(Vector3i const& position) noexcept;
+	/**
+	 * @brief Gets the chunk column [x, z], or nullptr if it is not loaded.
+	 */
+	ChunkColumn const* getColumnO(Vector2i const& position) const noexcept;
+	ChunkColumn* getColumnO(Vector2i const& position) noexcept;
 
 	Block* getBlockO(Vector3i const& position) const noexcept;
+	/**
+	 * @brief Sets a block, queues the light update and records the change in
+	 *  the journal.
+	 * @return False if the chunk of the block is not loaded.
+	 */
+	bool setBlock(Vector3i const& position, Block* const block);
+	/**
+	 * @brief Changes made by {@code setBlock} and the bulk edits. Each
+	 *  section of a column that is loaded or evicted is recorded as a chunk
+	 *  change.
+	 */
+	BlockJournal& getJournal() noexcept { return journal; }
+	WorldLocks& getLocks() const noexcept { return locks; }
+
+	/*
+	 * Bulk edits. The chunks in range are split among nThreads threads, which
+	 * process the contiguous rows of blocks of each chunk. Each chunk changed
+	 * is touched once and recorded once in the journal, and the columns
+	 * changed are relit from scratch along with their neighbours. Unloaded
+	 * chunks are skipped.
+	 */
+
+	/**
+	 * @brief Sets the blocks in the box [min, max] (inclusive).
+	 * @return Number of blocks changed.
+	 */
+	std::size_t fill(Vector3i const& min, Vector3i const& max,
+	                 Block* const block, unsigned int nThreads = 1);
+	/**
+	 * @brief Replaces from by to in the blocks within radius of centre.
+	 * @return Number of blocks changed.
+	 */
+	std::size_t replace(Vector3i const& centre, int radius,
+	                    Block* const from, Block* const to,
+	                    unsigned int nThreads = 1);
+	/**
+	 * @brief Counts the given block in the box [min, max] (inclusive).
+	 */
+	std::size_t count(Vector3i const& min, Vector3i const& max,
+	                  Block* const block, unsigned int nThreads = 1) const;
+	/**
+	 * @brief Finds the block of a type nearest to centre, at most radius
+	 *  away. Only the loaded chunks containing the type are searched, nearest
+	 *  first.
+	 * @param[out] position Position of the block found.
+	 * @return False if there is none.
+	 */
+	bool findNearest(Vector3i const& centre, int radius, Block* const block,
+	                 Vector3i& position) const;
+
+	/**
+	 * @brief Finds the first block other than {@code BlockNull} along a ray,
+	 *  by stepping through the blocks it crosses (Amanatides-Woo).
+	 *
+	 * The ray passes through the space above and below the world, and stops
+	 * at the horizontal world border or at an unloaded chunk.
+	 */
+	RayHit raycast(Ray const& ray) const noexcept;
+	/**
+	 * @brief Traces n rays, splitting them among nThreads threads. The chunks
+	 *  looked up by each thread are cached across its rays, so rays sharing an
+	 *  origin (line of sight, explosions) rarely look up the chunk map. The
+	 *  world must not be modified meanwhile.
+	 */
+	void raycast(Ray const* rays, RayHit* hits, std::size_t n,
+	             unsigned int nThreads = 1) const;
+	/**
+	 * @brief Moves a box along a displacement and finds the first solid block
+	 *  face it runs into.
+	 *
+	 * A block face is solid if {@code Block::isSideSolid} says so. Unloaded
+	 * chunks and the horizontal world border are solid; the space above and
+	 * below the world is not. Only the layers of blocks entered by the leading
+	 * faces of the box are tested, so blocks the box already overlaps do not
+	 * stop it.
+	 */
+	SweepHit sweep(Sweep const& s) const noexcept;
+	/**
+	 * @brief Sweeps n boxes on nThreads threads. The world must not be
+	 *  modified meanwhile.
+	 */
+	void sweep(Sweep const* sweeps, SweepHit* hits, std::size_t n,
+	           unsigned int nThreads = 1) const;
+	/**
+	 * @brief Moves a box as far as possible along a displacement, sliding
+	 *  along the faces it hits.
+	 * @return The displacement achieved.
+	 */
+	Vector3f slide(AABB const& box, Vector3f const& displacement) const noexcept;
+
+	/**
+	 * @brief Heightmap of a chunk column [x, z], or nullptr if the column is
+	 *  not loaded. Kept up to date by block changes.
+	 */
+	Heightmap const* getHeightmap(Vector2i const& column) const noexcept;
+	/**
+	 * @brief Height of the top block of the given kind at [x, z] (see
+	 *  {@code Heightmap}), or -1 if the column is not loaded.
+	 */
+	int getHeight(int x, int z, Heightmap::Kind kind) const noexcept;
+
+	/**
+	 * @brief Processes the light updates queued by block changes.
+	 */
+	void updateLight(unsigned int nThreads = 1) { light.update(nThreads); }
+	LightEngine& getLightEngine() noexcept { return light; }
+
+	/**
+	 * @brief Loads the given chunk columns [x, z] if they are not loaded.
+	 *
+	 * Columns that are already resident count as hits; missing columns count
+	 * as misses. The sections of a missing column are read by the loader, and
+	 * the column is generated if the loader does not have all of them.
+	 *
+	 * @param[in] positions Chunk column coordinates. Invalid columns are
+	 *  ignored.
+	 * @param[in] nThreads Number of threads generating the columns. The
+	 *  generated terrain does not depend on this.
+	 */
+	void loadColumns(std::vector<Vector2i> const& positions,
+	                 unsigned int nThreads = 1);
+	/**
+	 * @brief Loads the columns around the origin.
+	 */
+	void loadSpawn();
+
+	TerrainGenerator const& getGenerator() const noexcept { return generator; }
+
+	// Residency
+
+	void setMemoryBudget(std::size_t bytes) noexcept
+	{
+		residency.setBudget(bytes);
+	}
+	void setSaver(ChunkSaver s) { saver = std::move(s); }
+	void setLoader(ChunkLoader l) { loader = std::move(l); }
+	/**
+	 * @brief Passes all dirty chunks to the saver.
+	 * @return Number of chunks saved.
+	 */
+	std::size_t saveAll();
+	/**
+	 * @brief Reports the bytes of the mesh built from a chunk, so that they
+	 *  count towards the memory budget.
+	 */
+	void setMeshBytes(Vector3i const& position, std::size_t bytes) noexcept;
+	/**
+	 * @brief Marks the resident columns within radius of centre (in columns,
+	 *  on each axis) as the most recently used, typically those around the
+	 *  player every frame.
+	 */
+	void touchColumns(Vector2i const& centre, int radius) noexcept;
+	/**
+	 * @brief Evicts the least recently used columns that are out of range
+	 *  until the memory budget is met.
+	 *
+	 * Columns within radius of centre (in columns, on each axis) are in range.
+	 * The dirty sections of a column are passed to the saver first; without a
+	 * saver, or if saving fails, the column is kept.
+	 *
+	 * @return Number of columns evicted.
+	 */
+	std::size_t evict(Vector2i const& centre, int radius);
+	ResidencyStats getResidencyStats() const noexcept
+	{
+		return residency.stats();
+	}
+
+	static bool isValidChunk(Vector3i const& position) noexcept;
+	/**
+	 * @brief Chunk containing a point.
+	 */
+	static Vector3i chunkOf(Vector3f const& point) noexcept;
+	/**
+	 * @brief Packs valid chunk coordinates into one key.
+	 */
+	static std::int64_t chunkKey(Vector3i const& position) noexcept;
+	/**
+	 * @brief Inverse of {@code chunkKey}.
+	 */
+	static Vector3i chunkPosition(std::int64_t key) noexcept;
+	/**
+	 * @brief Packs valid column coordinates into one key.
+	 */
+	static std::int64_t columnKey(Vector2i const& position) noexcept
+	{
+		return chunkKey(Vector3i(position.x(), 0, position.y()));
+	}
 
 private:
-	Chunk fillChunk; ///< Filled with grass
+	/**
+	 * @brief Touches, journals and relights the chunks of a bulk edit.
+	 * @param[in] changes Position and number of blocks changed of each chunk.
+	 * @return Total number of blocks changed.
+	 */
+	std::size_t
+	onBulkEdit(std::vector<std::pair<Vector3i, std::size_t>> const& changes,
+	           unsigned int nThreads);
+	/**
+	 * @brief Passes the dirty sections of a column to the saver.
+	 * @return Number of sections saved.
+	 */
+	std::size_t saveColumn(ChunkColumn& column);
+	/**
+	 * @brief Records every section of a column in the journal.
+	 */
+	void journalColumn(Vector2i const& position) noexcept;
+
+	TerrainGenerator generator;
+	std::unordered_map<std::int64_t, std::unique_ptr<ChunkColumn>> columns;
+	ChunkResidency residency;
+	ChunkSaver saver;
+	ChunkLoader loader;
+	LightEngine light;
+	BlockJournal journal;
+	mutable WorldLocks locks;
+	/// Guards the light queue against concurrent writers
+	std::mutex mutexLight;
 };
 
 typedef World const WorldIn; ///< Read only version of a world.
@@ -70,12 +337,90 @@ World::getBlockO(Vector3i const& p) const noexcept
 inline ChunkIn*
 World::getChunkO(Vector3i const& position) const noexcept
 {
-	if ((position.x() == 0) &&
-			(position.y() == 0) &&
-			(position.z() == 0))
-		return &fillChunk;
+	return const_cast<World*>(this)->getChunkO(position);
+}
+inline Chunk*
+World::getChunkO(Vector3i const& position) noexcept
+{
+	if (!isValidChunk(position))
+		return nullptr;
+	auto it = columns.find(chunkKey(Vector3i(position.x(), 0, position.z())));
+	if (it == columns.end())
+		return nullptr;
 	else
+		return &it->second->getSection(position.y());
+}
+inline ChunkColumn const*
+World::getColumnO(Vector2i const& position) const noexcept
+{
+	return const_cast<World*>(this)->getColumnO(position);
+}
+inline ChunkColumn*
+World::getColumnO(Vector2i const& position) noexcept
+{
+	if (position.x() < -chunkXMax || position.x() >= chunkXMax ||
+	    position.y() < -chunkZMax || position.y() >= chunkZMax)
 		return nullptr;
+	auto it = columns.find(columnKey(position));
+	if (it == columns.end())
+		return nullptr;
+	else
+		return it->second.get();
+}
+inline Heightmap const*
+World::getHeightmap(Vector2i const& column) const noexcept
+{
+	ChunkColumn const* c = getColumnO(column);
+	return c ? &c->getHeightmap() : nullptr;
+}
+inline int
+World::getHeight(int x, int z, Heightmap::Kind kind) const noexcept
+{
+	Heightmap const* h = getHeightmap(Vector2i(divide_floor(x, Chunk::size),
+	                                           divide_floor(z, Chunk::size)));
+	if (!h)
+		return -1;
+	return h->get(kind, modulo_floor(x, Chunk::size),
+	              modulo_floor(z, Chunk::size));
+}
+inline bool
+World::isValidChunk(Vector3i const& p) noexcept
+{
+	return -chunkXMax <= p.x() && p.x() < chunkXMax &&
+	       -chunkZMax <= p.z() && p.z() < chunkZMax &&
+	       0 <= p.y() && p.y() < chunkYMax;
+}
+inline Vector3i
+World::chunkOf(Vector3f const& p) noexcept
+{
+	return Vector3i(divide_floor((int) std::floor(p.x()), Chunk::size),
+	                divide_floor((int) std::floor(p.y()), Chunk::size),
+	                divide_floor((int) std::floor(p.z()), Chunk::size));
+}
+inline void
+World::setMeshBytes(Vector3i const& position, std::size_t bytes) noexcept
+{
+	Vector2i const p(position.x(), position.z());
+	ChunkColumn* const column = getColumnO(p);
+	if (!column || !isValidChunk(position))
+		return;
+	column->setMeshBytes(position.y(), bytes);
+	residency.setMeshBytes(columnKey(p), column->getMeshBytes());
+}
+inline std::int64_t
+World::chunkKey(Vector3i const& p) noexcept
+{
+	// y takes the lowest 8 bits, z the next 32 bits and x the rest.
+	return ((std::int64_t) (p.x() + chunkXMax) << 40) |
+	       ((std::int64_t) (p.z() + chunkZMax) << 8) |
+	       (std::int64_t) (p.y() & 0xFF);
+}
+inline Vector3i
+World::chunkPosition(std::int64_t key) noexcept
+{
+	return Vector3i((int) (key >> 40) - chunkXMax,
+	                (int) (key & 0xFF),
+	                (int) ((key >> 8) & 0xFFFFFFFF) - chunkZMax);
 }
 
 } // namespace fab
@@ -0,0 +1,105 @@
+#include "WorldLocks.hpp"
+
+#include <cassert>
+#include <chrono>
+
+#include "../util/integers.hpp"
+
+namespace fab
+{
+
+constexpr int const WorldLocks::regionSize;
+constexpr int const WorldLocks::nShards;
+
+WorldLocks::Region::Region(WorldLocks& locks,
+                           Vector3i const& min, Vector3i const& max,
+                           Mode mode):
+	locks(locks),
+	mode(mode)
+{
+	assert(min.x() <= max.x() && min.z() <= max.z() &&
+	       "class WorldLocks: Region is inverted");
+	int const rxMin = divide_floor(min.x(), regionSize);
+	int const rxMax = divide_floor(max.x(), regionSize);
+	int const rzMin = divide_floor(min.z(), regionSize);
+	int const rzMax = divide_floor(max.z(), regionSize);
+	for (int rx = rxMin; rx <= rxMax && !shards.all(); ++rx)
+		for (int rz = rzMin; rz <= rzMax; ++rz)
+			shards.set(shardOf(rx * regionSize, rz * regionSize));
+
+	WorldLocks::lock(locks.structure, false, locks.counters);
+	for (int i = 0; i < nShards; ++i)
+		if (shards[i])
+			WorldLocks::lock(locks.shards[i].mutex, mode == WRITE,
+			                 locks.shards[i].counters);
+}
+WorldLocks::Region::~Region()
+{
+	for (int i = nShards - 1; i >= 0; --i)
+		if (shards[i])
+		{
+			if (mode == WRITE)
+				locks.shards[i].mutex.unlock();
+			else
+				locks.shards[i].mutex.unlock_shared();
+		}
+	locks.structure.unlock_shared();
+}
+
+WorldLocks::Exclusive::Exclusive(WorldLocks& locks):
+	locks(locks)
+{
+	WorldLocks::lock(locks.structure, true, locks.counters);
+}
+WorldLocks::Exclusive::~Exclusive()
+{
+	locks.structure.unlock();
+}
+
+WorldLocks::WorldLocks() noexcept
+{
+}
+
+int WorldLocks::shardOf(int x, int z) noexcept
+{
+	std::uint32_t const rx = divide_floor(x, regionSize);
+	std::uint32_t const rz = divide_floor(z, regionSize);
+	// Regions next to each other land on different shards.
+	return (rx * 5 + rz * 3) & (nShards - 1);
+}
+
+LockStats WorldLocks::stats() const noexcept
+{
+	LockStats s;
+	s.acquisitions = counters.acquisitions;
+	s.contended = counters.contended;
+	s.waitNs = counters.waitNs;
+	for (auto const& shard: shards)
+	{
+		s.acquisitions += shard.counters.acquisitions;
+		s.contended += shard.counters.contended;
+		s.waitNs += shard.counters.waitNs;
+	}
+	return s;
+}
+
+void WorldLocks::lock(std::shared_timed_mutex& mutex, bool exclusive,
+                      Counters& counters)
+{
+	counters.acquisitions.fetch_add(1, std::memory_order_relaxed);
+	if (exclusive ? mutex.try_lock() : mutex.try_lock_shared())
+		return;
+
+	namespace sc = std::chrono;
+	auto const begin = sc::steady_clock::now();
+	if (exclusive)
+		mutex.lock();
+	else
+		mutex.lock_shared();
+	auto const wait = sc::steady_clock::now() - begin;
+	counters.contended.fetch_add(1, std::memory_order_relaxed);
+	counters.waitNs.fetch_add(sc::duration_cast<sc::nanoseconds>(wait).count(),
+	                          std::memory_order_relaxed);
+}
+
+} // namespace fab
@@ -0,0 +1,116 @@
+#ifndef FABRICA_WORLD_WORLDLOCKS_HPP_
+#define FABRICA_WORLD_WORLDLOCKS_HPP_
+
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <shared_mutex>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "../util/vector.hpp"
+
+namespace fab
+{
+
+/**
+ * @brief Lock counters of a {@code WorldLocks}.
+ */
+struct LockStats
+{
+	std::uint64_t acquisitions; ///< Locks taken, shard by shard
+	std::uint64_t contended; ///< Locks that had to wait
+	std::uint64_t waitNs; ///< Total time spent waiting, in nanoseconds
+};
+
+/**
+ * @brief Reader-writer locks of the chunks of a {@code World}.
+ *
+ * The chunk columns are grouped into square regions of regionSize columns,
+ * and the regions are hashed onto nShards shared mutexes. A {@code Region}
+ * lock takes the shards covering a box of chunks, either shared (to read
+ * blocks) or exclusively (to modify them), so readers run in parallel and a
+ * writer only blocks the regions it touches. An {@code Exclusive} lock stops
+ * every other access, for operations that add or remove chunks or that span
+ * the whole world.
+ *
+ * All locks first take a structure mutex (shared, except for
+ * {@code Exclusive}) and then their shards in ascending order, so they cannot
+ * deadlock against each other. Locks are not recursive.
+ */
+class WorldLocks final: boost::noncopyable
+{
+public:
+	static constexpr int const regionSize = 4; ///< In chunk columns
+	static constexpr int const nShards = 64;
+
+	enum Mode
+	{
+		READ,
+		WRITE,
+	};
+
+	/**
+	 * @brief Locks the regions covering the chunks in [min, max] (inclusive)
+	 *  for the lifetime of the object.
+	 */
+	class Region final: boost::noncopyable
+	{
+	public:
+		Region(WorldLocks& locks, Vector3i const& min, Vector3i const& max,
+		       Mode mode);
+		~Region();
+
+	private:
+		WorldLocks& locks;
+		std::bitset<nShards> shards;
+		Mode mode;
+	};
+	/**
+	 * @brief Locks the whole world for the lifetime of the object.
+	 */
+	class Exclusive final: boost::noncopyable
+	{
+	public:
+		Exclusive(WorldLocks& locks);
+		~Exclusive();
+
+	private:
+		WorldLocks& locks;
+	};
+
+	WorldLocks() noexcept;
+
+	/**
+	 * @brief Shard of the chunk column [x, z].
+	 */
+	static int shardOf(int x, int z) noexcept;
+
+	LockStats stats() const noexcept;
+
+private:
+	struct Counters
+	{
+		Counters() noexcept: acquisitions(0), contended(0), waitNs(0) {}
+
+		std::atomic<std::uint64_t> acquisitions;
+		std::atomic<std::uint64_t> contended;
+		std::atomic<std::uint64_t> waitNs;
+	};
+	struct Shard
+	{
+		std::shared_timed_mutex mutex;
+		Counters counters;
+	};
+
+	static void lock(std::shared_timed_mutex& mutex, bool exclusive,
+	                 Counters& counters);
+
+	std::shared_timed_mutex structure;
+	Counters counters; ///< Of the structure mutex
+	Shard shards[nShards];
+};
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_WORLDLOCKS_HPP_
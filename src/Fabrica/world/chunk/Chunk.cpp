@@ -4,13 +4,38 @@ namespace fab
 {
 
 constexpr int const Chunk::size;
+constexpr int const Chunk::volume;
 
-Chunk::Chunk()
+Chunk::Chunk():
+	dirty(false),
+	revision(0)
 {
 	for (int i = 0; i < size; ++i)
 		for (int j = 0; j < size; ++j)
 			for (int k = 0; k < size; ++k)
 				blocks[i][j][k] = &BlockNull::instance;
+	counts.push_back(BlockCount{&BlockNull::instance, volume});
+	clearLight();
+}
+
+void Chunk::recount()
+{
+	counts.clear();
+	for (int i = 0; i < size; ++i)
+		for (int j = 0; j < size; ++j)
+		{
+			// Rows are often uniform
+			Block* const* const row = blocks[i][j];
+			int k = 0;
+			while (k < size)
+			{
+				int end = k + 1;
+				while (end < size && row[end] == row[k])
+					++end;
+				count(row[k], end - k);
+				k = end;
+			}
+		}
 }
 
 } // namespace fab
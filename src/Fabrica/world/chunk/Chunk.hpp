@@ -1,6 +1,12 @@
 #ifndef FABRICA_WORLD_CHUNK_CHUNK_HPP_
 #define FABRICA_WORLD_CHUNK_CHUNK_HPP_
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
 #include "../../block/Block.hpp"
 #include "../../util/vector.hpp"
 
@@ -9,21 +15,131 @@ namespace fab
 
 /**
  * 16x16x16 area of block.
+ *
+ * Each cell also has a 4 bit sky light and block light level, stored in nibble
+ * arrays indexed by {@code cell(x, y, z)}. Light is computed by
+ * {@code LightEngine} and does not make the chunk dirty.
+ *
+ * The chunk counts the blocks of each type it contains, so that searches can
+ * skip chunks without the type they look for. A chunk holds few types, so the
+ * counts are a short list. Changing blocks may add a type to it, so
+ * {@code setBlock} and the row operations may allocate.
  */
 class Chunk final
 {
 public:
 	static constexpr int const size = 16;
+	static constexpr int const volume = size * size * size;
+
+	struct BlockCount
+	{
+		Block* block;
+		int count;
+	};
 
 	static Chunk& chunkNull() noexcept; ///< Chunk with all blocks being air.
 
 	Chunk(); ///< Initialises the Chunk with BlockNull.
 
-	void setBlock(Vector3i const& p, Block* const) noexcept;
+	void setBlock(Vector3i const& p, Block* const);
+	void setBlock(int x, int y, int z, Block* const);
 	Block* getBlock(Vector3i const& p) const noexcept;
 	Block* getBlock(int x, int y, int z) const noexcept;
+
+	/*
+	 * Operations on the blocks [z0, z1) of the row [x, y], which is contiguous
+	 * in memory. They return the number of blocks changed (or counted) and do
+	 * not {@code touch} the chunk.
+	 */
+	int fillRow(int x, int y, int z0, int z1, Block* const);
+	int replaceRow(int x, int y, int z0, int z1,
+	               Block* const from, Block* const to);
+	int countRow(int x, int y, int z0, int z1, Block* const) const noexcept;
+
+	/**
+	 * @brief Number of blocks of a type in the chunk.
+	 */
+	int countBlock(Block* const) const noexcept;
+	/**
+	 * @brief Types of block present in the chunk (with a count above 0), in no
+	 *  particular order.
+	 */
+	std::vector<BlockCount> const& getBlockCounts() const noexcept
+	{
+		return counts;
+	}
+
+	static int cell(int x, int y, int z) noexcept
+	{
+		return (x * size + y) * size + z;
+	}
+	int getSkyLight(int cell) const noexcept;
+	int getBlockLight(int cell) const noexcept;
+	void setSkyLight(int cell, int level) noexcept;
+	void setBlockLight(int cell, int level) noexcept;
+	/**
+	 * @brief Sets all sky and block light to 0.
+	 */
+	void clearLight() noexcept;
+
+	/**
+	 * @brief A chunk is dirty if it has been modified since it was last saved.
+	 *  {@code setBlock} marks the chunk dirty.
+	 */
+	bool isDirty() const noexcept { return dirty; }
+	void setDirty(bool d) noexcept { dirty = d; }
+	/**
+	 * @brief Counts the modifications of the chunk, so that copies derived
+	 *  from it (e.g. meshes) can tell whether they are stale. {@code setBlock}
+	 *  counts one per block.
+	 */
+	std::uint32_t getRevision() const noexcept { return revision; }
+	/**
+	 * @brief Marks the chunk modified once: dirty and one revision further.
+	 *  Used after bulk changes.
+	 */
+	void touch() noexcept
+	{
+		dirty = true;
+		++revision;
+	}
+	/**
+	 * @brief Bytes of memory used by this chunk.
+	 */
+	std::size_t bytes() const noexcept
+	{
+		return sizeof(Chunk) + counts.capacity() * sizeof(BlockCount);
+	}
 private:
+	static int getNibble(std::uint8_t const* array, int cell) noexcept
+	{
+		return (array[cell >> 1] >> ((cell & 1) << 2)) & 0xF;
+	}
+	static void setNibble(std::uint8_t* array, int cell, int level) noexcept
+	{
+		int const shift = (cell & 1) << 2;
+		array[cell >> 1] = (array[cell >> 1] & ~(0xF << shift)) |
+		                   (level << shift);
+	}
+	/**
+	 * @brief Adds n (which may be negative) to the count of a type.
+	 */
+	void count(Block* const, int n);
+	/**
+	 * @brief Recomputes the counts from the blocks.
+	 */
+	void recount();
+
 	Block* blocks[size][size][size];
+	std::uint8_t skyLight[volume / 2];
+	std::uint8_t blockLight[volume / 2];
+	bool dirty;
+	std::uint32_t revision;
+	std::vector<BlockCount> counts;
+
+	friend class ChunkCodec; // Decodes directly into blocks
+	friend class TerrainGenerator; // Generates directly into blocks
+
 };
 
 typedef Chunk const ChunkIn; ///< Read only version of a chunk.
@@ -37,9 +153,124 @@ Chunk::chunkNull() noexcept
 	return c;
 }
 inline void
-Chunk::setBlock(Vector3i const& p, Block* const b) noexcept
+Chunk::setBlock(Vector3i const& p, Block* const b)
+{
+	setBlock(p.x(), p.y(), p.z(), b);
+}
+inline void
+Chunk::setBlock(int x, int y, int z, Block* const b)
+{
+	assert(0 <= x && x < size);
+	assert(0 <= y && y < size);
+	assert(0 <= z && z < size);
+	count(blocks[x][y][z], -1);
+	count(b, 1);
+	blocks[x][y][z] = b;
+	touch();
+}
+inline int
+Chunk::fillRow(int x, int y, int z0, int z1, Block* const b)
+{
+	assert(0 <= z0 && z0 <= z1 && z1 <= size);
+	Block** const row = blocks[x][y];
+	int n = 0;
+	for (int z = z0; z < z1; ++z)
+		n += row[z] != b;
+	// One pass per type present, rather than one lookup per block. Backwards,
+	// since types that run out are swapped with the last one.
+	for (std::size_t i = counts.size(); i-- > 0;)
+		if (counts[i].block != b)
+			count(counts[i].block, -countRow(x, y, z0, z1, counts[i].block));
+	count(b, n);
+	std::fill(row + z0, row + z1, b);
+	return n;
+}
+inline int
+Chunk::replaceRow(int x, int y, int z0, int z1,
+                  Block* const from, Block* const to)
+{
+	assert(0 <= z0 && z0 <= z1 && z1 <= size);
+	Block** const row = blocks[x][y];
+	int n = 0;
+	// Without branches, so that the loop is vectorised
+	for (int z = z0; z < z1; ++z)
+	{
+		bool const match = row[z] == from;
+		n += match;
+		row[z] = match ? to : row[z];
+	}
+	count(from, -n);
+	count(to, n);
+	return n;
+}
+inline int
+Chunk::countRow(int x, int y, int z0, int z1, Block* const b) const noexcept
+{
+	assert(0 <= z0 && z0 <= z1 && z1 <= size);
+	Block* const* const row = blocks[x][y];
+	int n = 0;
+	for (int z = z0; z < z1; ++z)
+		n += row[z] == b;
+	return n;
+}
+inline int
+Chunk::countBlock(Block* const b) const noexcept
+{
+	for (auto const& c: counts)
+		if (c.block == b)
+			return c.count;
+	return 0;
+}
+inline void
+Chunk::count(Block* const b, int n)
+{
+	if (!n) return;
+	for (std::size_t i = 0; i < counts.size(); ++i)
+		if (counts[i].block == b)
+		{
+			counts[i].count += n;
+			assert(counts[i].count >= 0 && "class Chunk: Negative count");
+			if (!counts[i].count)
+			{
+				counts[i] = counts.back();
+				counts.pop_back();
+			}
+			return;
+		}
+	assert(n > 0 && "class Chunk: Negative count");
+	counts.push_back(BlockCount{b, n});
+}
+inline int
+Chunk::getSkyLight(int cell) const noexcept
+{
+	assert(0 <= cell && cell < volume);
+	return getNibble(skyLight, cell);
+}
+inline int
+Chunk::getBlockLight(int cell) const noexcept
+{
+	assert(0 <= cell && cell < volume);
+	return getNibble(blockLight, cell);
+}
+inline void
+Chunk::setSkyLight(int cell, int level) noexcept
+{
+	assert(0 <= cell && cell < volume);
+	assert(0 <= level && level < 16);
+	setNibble(skyLight, cell, level);
+}
+inline void
+Chunk::setBlockLight(int cell, int level) noexcept
+{
+	assert(0 <= cell && cell < volume);
+	assert(0 <= level && level < 16);
+	setNibble(blockLight, cell, level);
+}
+inline void
+Chunk::clearLight() noexcept
 {
-	blocks[p.x()][p.y()][p.z()] = b;
+	std::memset(skyLight, 0, sizeof(skyLight));
+	std::memset(blockLight, 0, sizeof(blockLight));
 }
 inline Block*
 Chunk::getBlock(Vector3i const& p) const noexcept
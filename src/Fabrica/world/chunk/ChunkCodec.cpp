@@ -0,0 +1,286 @@
+#include "ChunkCodec.hpp"
+
+#include <cassert>
+
+namespace fab
+{
+
+namespace
+{
+
+int const nBlocks = Chunk::size * Chunk::size * Chunk::size;
+
+inline void writeVarint(std::string& out, std::uint32_t v)
+{
+	while (v >= 0x80)
+	{
+		out.push_back((char) (v | 0x80));
+		v >>= 7;
+	}
+	out.push_back((char) v);
+}
+inline int varintSize(std::uint32_t v) noexcept
+{
+	int n = 1;
+	for (; v >= 0x80; v >>= 7) ++n;
+	return n;
+}
+/**
+ * @brief Reads a varint of at most 3 bytes, enough for any value in a chunk.
+ */
+inline bool readVarint(unsigned char const*& p, unsigned char const* end,
+                       std::uint32_t* v) noexcept
+{
+	std::uint32_t result = 0;
+	for (int shift = 0; shift < 21; shift += 7)
+	{
+		if (p == end) return false;
+		unsigned char const byte = *p++;
+		result |= (std::uint32_t) (byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+		{
+			*v = result;
+			return true;
+		}
+	}
+	return false;
+}
+inline int bitsFor(int nPalette) noexcept
+{
+	int bits = 1;
+	while ((1 << bits) < nPalette) ++bits;
+	return bits;
+}
+
+} // namespace
+
+constexpr int const ChunkCodec::paletteMax;
+
+ChunkCodec::ChunkCodec():
+	blocks(1, &BlockNull::instance)
+{
+}
+
+void ChunkCodec::setBlocks(std::vector<Block*> const& b)
+{
+	assert(!b.empty() && b[0] == &BlockNull::instance &&
+	       "class ChunkCodec: Id 0 must be BlockNull");
+	blocks = b;
+	ids.clear();
+	for (std::size_t i = 1; i < blocks.size(); ++i)
+		if (blocks[i])
+			ids[blocks[i]] = i;
+}
+std::uint16_t ChunkCodec::getBlockId(Block* block) const noexcept
+{
+	auto it = ids.find(block);
+	return it == ids.end() ? 0 : it->second;
+}
+Block* ChunkCodec::getBlock(std::uint16_t id) const noexcept
+{
+	return id < blocks.size() ? blocks[id] : nullptr;
+}
+
+void ChunkCodec::encode(ChunkIn& chunk, std::string& out) const
+{
+	// Palette indices in column order. The palette is searched linearly, with
+	// the last block cached since neighbours are usually equal.
+	std::uint8_t indices[nBlocks];
+	Block* palette[paletteMax];
+	int nPalette = 0;
+	Block* last = nullptr;
+	int lastIndex = 0;
+	std::size_t runsSize = 0;
+	int runLength = 0;
+
+	int i = 0;
+	for (int x = 0; x < Chunk::size; ++x)
+		for (int z = 0; z < Chunk::size; ++z)
+			for (int y = 0; y < Chunk::size; ++y, ++i)
+			{
+				Block* const b = chunk.blocks[x][y][z];
+				if (b != last)
+				{
+					if (runLength)
+						runsSize += varintSize(runLength) + varintSize(lastIndex);
+					runLength = 0;
+
+					int j = 0;
+					while (j < nPalette && palette[j] != b) ++j;
+					if (j == nPalette)
+					{
+						if (nPalette == paletteMax)
+						{
+							encodeRaw(chunk, out);
+							return;
+						}
+						palette[nPalette++] = b;
+					}
+					last = b;
+					lastIndex = j;
+				}
+				indices[i] = lastIndex;
+				++runLength;
+			}
+	runsSize += varintSize(runLength) + varintSize(lastIndex);
+
+	out.clear();
+	out.push_back((char) FORMAT_PALETTE);
+	writeVarint(out, nPalette);
+	for (int j = 0; j < nPalette; ++j)
+		writeVarint(out, getBlockId(palette[j]));
+
+	if (nPalette == 1)
+	{
+		out.push_back((char) MODE_SINGLE);
+		return;
+	}
+	int const bits = bitsFor(nPalette);
+	std::size_t const packedSize = nBlocks * bits / 8;
+	if (runsSize < packedSize)
+	{
+		out.push_back((char) MODE_RUNS);
+		int begin = 0;
+		for (int k = 1; k <= nBlocks; ++k)
+		{
+			if (k < nBlocks && indices[k] == indices[begin]) continue;
+			writeVarint(out, k - begin);
+			writeVarint(out, indices[begin]);
+			begin = k;
+		}
+		return;
+	}
+	out.push_back((char) MODE_PACKED);
+	std::uint32_t acc = 0;
+	int nAcc = 0;
+	for (int k = 0; k < nBlocks; ++k)
+	{
+		acc |= (std::uint32_t) indices[k] << nAcc;
+		nAcc += bits;
+		while (nAcc >= 8)
+		{
+			out.push_back((char) (acc & 0xFF));
+			acc >>= 8;
+			nAcc -= 8;
+		}
+	}
+	assert(nAcc == 0);
+}
+bool ChunkCodec::decode(char const* data, std::size_t length,
+                        Chunk& chunk) const
+{
+	bool const valid = decodeBlocks(data, length, chunk);
+	chunk.recount();
+	return valid;
+}
+bool ChunkCodec::decodeBlocks(char const* data, std::size_t length,
+                              Chunk& chunk) const noexcept
+{
+	unsigned char const* p = reinterpret_cast<unsigned char const*>(data);
+	unsigned char const* const end = p + length;
+	if (p == end) return false;
+
+	std::uint8_t const format = *p++;
+	if (format == FORMAT_RAW)
+	{
+		if (end - p != 2 * nBlocks) return false;
+		for (int x = 0; x < Chunk::size; ++x)
+			for (int y = 0; y < Chunk::size; ++y)
+				for (int z = 0; z < Chunk::size; ++z, p += 2)
+				{
+					Block* b = getBlock(p[0] | (p[1] << 8));
+					chunk.blocks[x][y][z] = b ? b : &BlockNull::instance;
+				}
+		return true;
+	}
+	if (format != FORMAT_PALETTE) return false;
+
+	std::uint32_t nPalette;
+	if (!readVarint(p, end, &nPalette) ||
+	    nPalette == 0 || nPalette > paletteMax)
+		return false;
+	Block* palette[paletteMax];
+	for (std::uint32_t j = 0; j < nPalette; ++j)
+	{
+		std::uint32_t id;
+		if (!readVarint(p, end, &id)) return false;
+		Block* b = id <= 0xFFFF ? getBlock(id) : nullptr;
+		palette[j] = b ? b : &BlockNull::instance;
+	}
+	if (p == end) return false;
+	std::uint8_t const mode = *p++;
+
+	if (mode == MODE_SINGLE)
+	{
+		if (p != end) return false;
+		for (int x = 0; x < Chunk::size; ++x)
+			for (int y = 0; y < Chunk::size; ++y)
+				for (int z = 0; z < Chunk::size; ++z)
+					chunk.blocks[x][y][z] = palette[0];
+		return true;
+	}
+	if (mode == MODE_RUNS)
+	{
+		Block* b = nullptr;
+		std::uint32_t remaining = 0;
+		for (int x = 0; x < Chunk::size; ++x)
+			for (int z = 0; z < Chunk::size; ++z)
+				for (int y = 0; y < Chunk::size; ++y)
+				{
+					if (remaining == 0)
+					{
+						std::uint32_t index;
+						if (!readVarint(p, end, &remaining) ||
+						    !readVarint(p, end, &index) ||
+						    remaining == 0 || index >= nPalette)
+							return false;
+						b = palette[index];
+					}
+					chunk.blocks[x][y][z] = b;
+					--remaining;
+				}
+		return remaining == 0 && p == end;
+	}
+	if (mode == MODE_PACKED)
+	{
+		int const bits = bitsFor(nPalette);
+		if (end - p != nBlocks * bits / 8) return false;
+		std::uint32_t const mask = (1u << bits) - 1;
+		std::uint32_t acc = 0;
+		int nAcc = 0;
+		for (int x = 0; x < Chunk::size; ++x)
+			for (int z = 0; z < Chunk::size; ++z)
+				for (int y = 0; y < Chunk::size; ++y)
+				{
+					while (nAcc < bits)
+					{
+						acc |= (std::uint32_t) *p++ << nAcc;
+						nAcc += 8;
+					}
+					std::uint32_t const index = acc & mask;
+					acc >>= bits;
+					nAcc -= bits;
+					if (index >= nPalette) return false;
+					chunk.blocks[x][y][z] = palette[index];
+				}
+		return true;
+	}
+	return false;
+}
+
+void ChunkCodec::encodeRaw(ChunkIn& chunk, std::string& out) const
+{
+	out.resize(1 + 2 * nBlocks);
+	out[0] = (char) FORMAT_RAW;
+	char* p = &out[1];
+	for (int x = 0; x < Chunk::size; ++x)
+		for (int y = 0; y < Chunk::size; ++y)
+			for (int z = 0; z < Chunk::size; ++z)
+			{
+				std::uint16_t const id = getBlockId(chunk.blocks[x][y][z]);
+				*p++ = (char) (id & 0xFF);
+				*p++ = (char) (id >> 8);
+			}
+}
+
+} // namespace fab
@@ -0,0 +1,103 @@
+#ifndef FABRICA_WORLD_CHUNK_CHUNKCODEC_HPP_
+#define FABRICA_WORLD_CHUNK_CHUNKCODEC_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Chunk.hpp"
+
+namespace fab
+{
+
+/**
+ * @brief Serialises chunks with block Ids.
+ *
+ * Formats (first byte of the encoded chunk):
+ *
+ * FORMAT_RAW: 4096 block Ids as little-endian 16 bit integers.
+ *
+ * FORMAT_PALETTE:
+ *	varint P, P varint block Ids (the palette)
+ *	byte mode, then
+ *	MODE_SINGLE: Nothing, every block is the palette entry 0.
+ *	MODE_PACKED: 4096 palette indices of ceil(log2(P)) bits, least significant
+ *		bit first.
+ *	MODE_RUNS: Runs of {varint length, varint palette index} covering the 4096
+ *		blocks.
+ *
+ * Blocks are visited in column order (x, then z, then y fastest), so that a
+ * column of terrain is a few long runs. The encoder picks the smaller of
+ * MODE_PACKED and MODE_RUNS, and falls back to FORMAT_RAW for chunks with more
+ * than paletteMax distinct blocks.
+ *
+ * Decoding writes directly into the chunk storage. It only allocates to
+ * recount the types of block of the chunk.
+ */
+class ChunkCodec final
+{
+public:
+	enum Format: std::uint8_t
+	{
+		FORMAT_RAW = 0,
+		FORMAT_PALETTE = 1,
+	};
+	enum Mode: std::uint8_t
+	{
+		MODE_SINGLE = 0,
+		MODE_PACKED = 1,
+		MODE_RUNS = 2,
+	};
+	/// Palette indices are packed in at most 8 bits.
+	static constexpr int const paletteMax = 256;
+
+	/**
+	 * @brief Creates a codec that only knows {@code BlockNull} (Id 0).
+	 */
+	ChunkCodec();
+
+	/**
+	 * @param[in] blocks Blocks by Id. Entry 0 must be {@code BlockNull}.
+	 *  Entries may be nullptr for unknown blocks, which decode to
+	 *  {@code BlockNull}.
+	 */
+	void setBlocks(std::vector<Block*> const& blocks);
+	/**
+	 * @brief Id of a block. Unknown blocks have Id 0.
+	 */
+	std::uint16_t getBlockId(Block* block) const noexcept;
+	/**
+	 * @brief Block with the given Id, or nullptr if there is none.
+	 */
+	Block* getBlock(std::uint16_t id) const noexcept;
+
+	/**
+	 * @brief Encodes a chunk into out, replacing its contents. The capacity of
+	 *  out is reused.
+	 */
+	void encode(ChunkIn& chunk, std::string& out) const;
+	/**
+	 * @brief Decodes a chunk. Does not change the dirty flag of the chunk.
+	 * @return False if the data is malformed, in which case the chunk is left
+	 *  in an unspecified state.
+	 */
+	bool decode(char const* data, std::size_t length, Chunk& chunk) const;
+
+private:
+	void encodeRaw(ChunkIn& chunk, std::string& out) const;
+	/**
+	 * @brief Decodes the blocks of a chunk, without updating its block
+	 *  counts.
+	 */
+	bool decodeBlocks(char const* data, std::size_t length,
+	                  Chunk& chunk) const noexcept;
+
+	std::vector<Block*> blocks;
+	std::unordered_map<Block*, std::uint16_t> ids;
+};
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_CHUNK_CHUNKCODEC_HPP_
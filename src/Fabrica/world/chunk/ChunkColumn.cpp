@@ -0,0 +1,42 @@
+#include "ChunkColumn.hpp"
+
+namespace fab
+{
+
+constexpr int const ChunkColumn::height;
+
+ChunkColumn::ChunkColumn(Vector2i const& position) noexcept:
+	position(position),
+	meshBytes()
+{
+}
+
+bool ChunkColumn::isDirty() const noexcept
+{
+	for (auto const& s: sections)
+		if (s.isDirty())
+			return true;
+	return false;
+}
+
+void ChunkColumn::setMeshBytes(int y, std::size_t bytes) noexcept
+{
+	assert(0 <= y && y < height && "class ChunkColumn: Invalid section");
+	meshBytes[y] = bytes;
+}
+std::size_t ChunkColumn::getMeshBytes() const noexcept
+{
+	std::size_t total = 0;
+	for (auto b: meshBytes)
+		total += b;
+	return total;
+}
+std::size_t ChunkColumn::bytes() const noexcept
+{
+	std::size_t n = sizeof(ChunkColumn);
+	for (auto const& s: sections)
+		n += s.bytes() - sizeof(Chunk); // Counts of the section
+	return n;
+}
+
+} // namespace fab
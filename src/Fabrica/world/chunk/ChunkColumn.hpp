@@ -0,0 +1,86 @@
+#ifndef FABRICA_WORLD_CHUNK_CHUNKCOLUMN_HPP_
+#define FABRICA_WORLD_CHUNK_CHUNKCOLUMN_HPP_
+
+#include <cstddef>
+
+#include <boost/core/noncopyable.hpp>
+
+#include "Chunk.hpp"
+#include "../Heightmap.hpp"
+#include "../../util/vector.hpp"
+
+namespace fab
+{
+
+/**
+ * @brief The vertical stack of chunks at one column [x, z] of a
+ *  {@code World}, with the data shared by the stack.
+ *
+ * Columns are loaded, saved and evicted as a whole, so a resident column
+ * always has all its sections. The heightmap is kept up to date by
+ * {@code World}.
+ */
+class ChunkColumn final: boost::noncopyable
+{
+public:
+	static constexpr int const height = 16; ///< Number of sections
+
+	/**
+	 * @brief Initialises all sections with BlockNull.
+	 */
+	ChunkColumn(Vector2i const& position) noexcept;
+
+	Vector2i const& getPosition() const noexcept { return position; }
+
+	/**
+	 * @brief Section y, counted from the bottom.
+	 */
+	Chunk& getSection(int y) noexcept;
+	ChunkIn& getSection(int y) const noexcept;
+
+	Heightmap& getHeightmap() noexcept { return heightmap; }
+	Heightmap const& getHeightmap() const noexcept { return heightmap; }
+
+	/**
+	 * @brief Whether any section is dirty.
+	 */
+	bool isDirty() const noexcept;
+
+	/**
+	 * @brief Reports the bytes of the mesh built from a section.
+	 */
+	void setMeshBytes(int y, std::size_t bytes) noexcept;
+	/**
+	 * @brief Bytes of the meshes of all sections.
+	 */
+	std::size_t getMeshBytes() const noexcept;
+	/**
+	 * @brief Bytes of memory used by the column, without meshes.
+	 */
+	std::size_t bytes() const noexcept;
+
+private:
+	Vector2i position;
+	Chunk sections[height];
+	Heightmap heightmap;
+	std::size_t meshBytes[height];
+};
+
+// Implementations
+
+inline Chunk&
+ChunkColumn::getSection(int y) noexcept
+{
+	assert(0 <= y && y < height && "class ChunkColumn: Invalid section");
+	return sections[y];
+}
+inline ChunkIn&
+ChunkColumn::getSection(int y) const noexcept
+{
+	assert(0 <= y && y < height && "class ChunkColumn: Invalid section");
+	return sections[y];
+}
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_CHUNK_CHUNKCOLUMN_HPP_
@@ -0,0 +1,330 @@
+#include "SimplexNoise.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+	#define FABRICA_NOISE_X86
+	#include <immintrin.h>
+#endif
+
+namespace fab
+{
+
+/*
+ * Every kernel below must perform exactly the same floating point operations
+ * in the same order as {@code noiseScalar}. Do not "simplify" the arithmetic
+ * of one kernel without changing the others, or the terrain will depend on the
+ * processor it is generated on.
+ */
+
+namespace
+{
+
+float const F2 = 0.366025403784f;   // (sqrt(3) - 1) / 2
+float const G2 = 0.211324865405f;   // (3 - sqrt(3)) / 6
+float const G2x2m1 = 2.f * G2 - 1.f;
+float const scale = 45.f;           // Brings the output to about [-1, 1]
+
+std::uint32_t const hashX = 0x27d4eb2du;
+std::uint32_t const hashY = 0x165667b1u;
+std::uint32_t const hashM = 0x2c1b3c6du;
+
+inline std::uint32_t hashScalar(std::int32_t i, std::int32_t j,
+                                std::uint32_t seed) noexcept
+{
+	std::uint32_t h = ((std::uint32_t) i * hashX) ^
+	                  ((std::uint32_t) j * hashY) ^
+	                  seed;
+	h ^= h >> 15;
+	h *= hashM;
+	h ^= h >> 12;
+	return h;
+}
+inline float cornerScalar(std::uint32_t h, float x, float y) noexcept
+{
+	float t = 0.5f - x * x - y * y;
+	t = t > 0.f ? t : 0.f;
+	t = t * t;
+
+	float u = (h & 4) ? y : x;
+	float v = (h & 4) ? x : y;
+	u = (h & 1) ? -u : u;
+	v = v + v;
+	v = (h & 2) ? -v : v;
+	return t * t * (u + v);
+}
+float noiseScalar(float x, float y, std::uint32_t seed) noexcept
+{
+	float const s = (x + y) * F2;
+	float const fi = std::floor(x + s);
+	float const fj = std::floor(y + s);
+	std::int32_t const i = (std::int32_t) fi;
+	std::int32_t const j = (std::int32_t) fj;
+	float const t = (fi + fj) * G2;
+
+	float const x0 = x - (fi - t);
+	float const y0 = y - (fj - t);
+	bool const lower = x0 > y0; // Which of the two triangles
+	float const i1 = lower ? 1.f : 0.f;
+	float const j1 = lower ? 0.f : 1.f;
+	float const x1 = x0 - i1 + G2;
+	float const y1 = y0 - j1 + G2;
+	float const x2 = x0 + G2x2m1;
+	float const y2 = y0 + G2x2m1;
+
+	float const n0 = cornerScalar(hashScalar(i, j, seed), x0, y0);
+	float const n1 = cornerScalar(hashScalar(i + lower, j + !lower, seed),
+	                              x1, y1);
+	float const n2 = cornerScalar(hashScalar(i + 1, j + 1, seed), x2, y2);
+	return (n0 + n1 + n2) * scale;
+}
+
+#ifdef FABRICA_NOISE_X86
+
+// SSE2
+
+/**
+ * SSE2 does not have a 32 bit low multiplication, so it is emulated with two
+ * 32x32->64 multiplications.
+ */
+inline __m128i mullo32SSE2(__m128i a, __m128i b) noexcept
+{
+	__m128i const even = _mm_mul_epu32(a, b);
+	__m128i const odd = _mm_mul_epu32(_mm_srli_si128(a, 4),
+	                                  _mm_srli_si128(b, 4));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+	                          _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+inline __m128i hashSSE2(__m128i i, __m128i j, __m128i seed) noexcept
+{
+	__m128i h = _mm_xor_si128(
+	              _mm_xor_si128(mullo32SSE2(i, _mm_set1_epi32(hashX)),
+	                            mullo32SSE2(j, _mm_set1_epi32(hashY))),
+	              seed);
+	h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+	h = mullo32SSE2(h, _mm_set1_epi32(hashM));
+	h = _mm_xor_si128(h, _mm_srli_epi32(h, 12));
+	return h;
+}
+inline __m128 cornerSSE2(__m128i h, __m128 x, __m128 y) noexcept
+{
+	__m128 t = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(0.5f), _mm_mul_ps(x, x)),
+	                      _mm_mul_ps(y, y));
+	t = _mm_max_ps(t, _mm_setzero_ps());
+	t = _mm_mul_ps(t, t);
+
+	__m128i const one = _mm_set1_epi32(1);
+	__m128 const swap = _mm_castsi128_ps(
+	                      _mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(4)),
+	                                      _mm_set1_epi32(4)));
+	__m128 u = _mm_or_ps(_mm_and_ps(swap, y), _mm_andnot_ps(swap, x));
+	__m128 v = _mm_or_ps(_mm_and_ps(swap, x), _mm_andnot_ps(swap, y));
+	// Sign flips
+	u = _mm_xor_ps(u, _mm_castsi128_ps(
+	                 _mm_slli_epi32(_mm_and_si128(h, one), 31)));
+	v = _mm_add_ps(v, v);
+	v = _mm_xor_ps(v, _mm_castsi128_ps(
+	                 _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30)));
+	return _mm_mul_ps(_mm_mul_ps(t, t), _mm_add_ps(u, v));
+}
+inline __m128 noiseSSE2(__m128 x, __m128 y, __m128i seed) noexcept
+{
+	__m128 const one = _mm_set1_ps(1.f);
+	__m128 const g2 = _mm_set1_ps(G2);
+
+	__m128 const s = _mm_mul_ps(_mm_add_ps(x, y), _mm_set1_ps(F2));
+	// Floor by truncation, then correct negative non-integers
+	__m128 fi = _mm_add_ps(x, s);
+	__m128 fj = _mm_add_ps(y, s);
+	__m128i i = _mm_cvttps_epi32(fi);
+	__m128i j = _mm_cvttps_epi32(fj);
+	{
+		__m128 const ti = _mm_cvtepi32_ps(i);
+		__m128 const tj = _mm_cvtepi32_ps(j);
+		__m128 const mi = _mm_cmpgt_ps(ti, fi);
+		__m128 const mj = _mm_cmpgt_ps(tj, fj);
+		fi = _mm_sub_ps(ti, _mm_and_ps(mi, one));
+		fj = _mm_sub_ps(tj, _mm_and_ps(mj, one));
+		i = _mm_add_epi32(i, _mm_castps_si128(mi)); // mask = -1
+		j = _mm_add_epi32(j, _mm_castps_si128(mj));
+	}
+	__m128 const t = _mm_mul_ps(_mm_add_ps(fi, fj), g2);
+
+	__m128 const x0 = _mm_sub_ps(x, _mm_sub_ps(fi, t));
+	__m128 const y0 = _mm_sub_ps(y, _mm_sub_ps(fj, t));
+	__m128 const lower = _mm_cmpgt_ps(x0, y0);
+	__m128 const i1 = _mm_and_ps(lower, one);
+	__m128 const j1 = _mm_andnot_ps(lower, one);
+	__m128 const x1 = _mm_add_ps(_mm_sub_ps(x0, i1), g2);
+	__m128 const y1 = _mm_add_ps(_mm_sub_ps(y0, j1), g2);
+	__m128 const x2 = _mm_add_ps(x0, _mm_set1_ps(G2x2m1));
+	__m128 const y2 = _mm_add_ps(y0, _mm_set1_ps(G2x2m1));
+
+	__m128i const oneI = _mm_set1_epi32(1);
+	__m128i const lowerI = _mm_castps_si128(lower);
+	__m128 const n0 = cornerSSE2(hashSSE2(i, j, seed), x0, y0);
+	__m128 const n1 = cornerSSE2(hashSSE2(_mm_sub_epi32(i, lowerI),
+	                                      _mm_add_epi32(j, _mm_add_epi32(oneI, lowerI)),
+	                                      seed),
+	                             x1, y1);
+	__m128 const n2 = cornerSSE2(hashSSE2(_mm_add_epi32(i, oneI),
+	                                      _mm_add_epi32(j, oneI),
+	                                      seed),
+	                             x2, y2);
+	return _mm_mul_ps(_mm_add_ps(_mm_add_ps(n0, n1), n2), _mm_set1_ps(scale));
+}
+void sampleSSE2(float const* x, float const* y, float* out, std::size_t n,
+                std::uint32_t seed) noexcept
+{
+	__m128i const s = _mm_set1_epi32(seed);
+	std::size_t i = 0;
+	// Two vectors per iteration, matching the AVX2 batch width of 8
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm_storeu_ps(out + i, noiseSSE2(_mm_loadu_ps(x + i),
+		                                 _mm_loadu_ps(y + i), s));
+		_mm_storeu_ps(out + i + 4, noiseSSE2(_mm_loadu_ps(x + i + 4),
+		                                     _mm_loadu_ps(y + i + 4), s));
+	}
+	for (; i < n; ++i)
+		out[i] = noiseScalar(x[i], y[i], seed);
+}
+
+// AVX2
+
+__attribute__((target("avx2")))
+inline __m256i hashAVX2(__m256i i, __m256i j, __m256i seed) noexcept
+{
+	__m256i h = _mm256_xor_si256(
+	              _mm256_xor_si256(_mm256_mullo_epi32(i, _mm256_set1_epi32(hashX)),
+	                               _mm256_mullo_epi32(j, _mm256_set1_epi32(hashY))),
+	              seed);
+	h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+	h = _mm256_mullo_epi32(h, _mm256_set1_epi32(hashM));
+	h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 12));
+	return h;
+}
+__attribute__((target("avx2")))
+inline __m256 cornerAVX2(__m256i h, __m256 x, __m256 y) noexcept
+{
+	__m256 t = _mm256_sub_ps(_mm256_sub_ps(_mm256_set1_ps(0.5f),
+	                                       _mm256_mul_ps(x, x)),
+	                         _mm256_mul_ps(y, y));
+	t = _mm256_max_ps(t, _mm256_setzero_ps());
+	t = _mm256_mul_ps(t, t);
+
+	__m256 const swap = _mm256_castsi256_ps(
+	                      _mm256_cmpeq_epi32(
+	                        _mm256_and_si256(h, _mm256_set1_epi32(4)),
+	                        _mm256_set1_epi32(4)));
+	__m256 u = _mm256_blendv_ps(x, y, swap);
+	__m256 v = _mm256_blendv_ps(y, x, swap);
+	u = _mm256_xor_ps(u, _mm256_castsi256_ps(
+	                    _mm256_slli_epi32(
+	                      _mm256_and_si256(h, _mm256_set1_epi32(1)), 31)));
+	v = _mm256_add_ps(v, v);
+	v = _mm256_xor_ps(v, _mm256_castsi256_ps(
+	                    _mm256_slli_epi32(
+	                      _mm256_and_si256(h, _mm256_set1_epi32(2)), 30)));
+	return _mm256_mul_ps(_mm256_mul_ps(t, t), _mm256_add_ps(u, v));
+}
+__attribute__((target("avx2")))
+inline __m256 noiseAVX2(__m256 x, __m256 y, __m256i seed) noexcept
+{
+	__m256 const one = _mm256_set1_ps(1.f);
+	__m256 const g2 = _mm256_set1_ps(G2);
+
+	__m256 const s = _mm256_mul_ps(_mm256_add_ps(x, y), _mm256_set1_ps(F2));
+	__m256 const fi = _mm256_floor_ps(_mm256_add_ps(x, s));
+	__m256 const fj = _mm256_floor_ps(_mm256_add_ps(y, s));
+	__m256i const i = _mm256_cvttps_epi32(fi);
+	__m256i const j = _mm256_cvttps_epi32(fj);
+	__m256 const t = _mm256_mul_ps(_mm256_add_ps(fi, fj), g2);
+
+	__m256 const x0 = _mm256_sub_ps(x, _mm256_sub_ps(fi, t));
+	__m256 const y0 = _mm256_sub_ps(y, _mm256_sub_ps(fj, t));
+	__m256 const lower = _mm256_cmp_ps(x0, y0, _CMP_GT_OQ);
+	__m256 const i1 = _mm256_and_ps(lower, one);
+	__m256 const j1 = _mm256_andnot_ps(lower, one);
+	__m256 const x1 = _mm256_add_ps(_mm256_sub_ps(x0, i1), g2);
+	__m256 const y1 = _mm256_add_ps(_mm256_sub_ps(y0, j1), g2);
+	__m256 const x2 = _mm256_add_ps(x0, _mm256_set1_ps(G2x2m1));
+	__m256 const y2 = _mm256_add_ps(y0, _mm256_set1_ps(G2x2m1));
+
+	__m256i const oneI = _mm256_set1_epi32(1);
+	__m256i const lowerI = _mm256_castps_si256(lower);
+	__m256 const n0 = cornerAVX2(hashAVX2(i, j, seed), x0, y0);
+	__m256 const n1 = cornerAVX2(
+	                    hashAVX2(_mm256_sub_epi32(i, lowerI),
+	                             _mm256_add_epi32(j, _mm256_add_epi32(oneI, lowerI)),
+	                             seed),
+	                    x1, y1);
+	__m256 const n2 = cornerAVX2(hashAVX2(_mm256_add_epi32(i, oneI),
+	                                      _mm256_add_epi32(j, oneI),
+	                                      seed),
+	                             x2, y2);
+	return _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(n0, n1), n2),
+	                     _mm256_set1_ps(scale));
+}
+__attribute__((target("avx2")))
+void sampleAVX2(float const* x, float const* y, float* out, std::size_t n,
+                std::uint32_t seed) noexcept
+{
+	__m256i const s = _mm256_set1_epi32(seed);
+	std::size_t i = 0;
+	for (; i + 8 <= n; i += 8)
+	{
+		_mm256_storeu_ps(out + i, noiseAVX2(_mm256_loadu_ps(x + i),
+		                                    _mm256_loadu_ps(y + i), s));
+	}
+	for (; i < n; ++i)
+		out[i] = noiseScalar(x[i], y[i], seed);
+}
+
+#endif // FABRICA_NOISE_X86
+
+} // namespace
+
+float SimplexNoise::sample(float x, float y) const noexcept
+{
+	return noiseScalar(x, y, seed);
+}
+void SimplexNoise::sample(float const* x, float const* y, float* out,
+                          std::size_t n) const noexcept
+{
+	static Kernel const kernel = bestKernel();
+	sample(x, y, out, n, kernel);
+}
+void SimplexNoise::sample(float const* x, float const* y, float* out,
+                          std::size_t n, Kernel kernel) const noexcept
+{
+	kernel = std::min(kernel, bestKernel());
+	switch (kernel)
+	{
+#ifdef FABRICA_NOISE_X86
+	case KERNEL_AVX2:
+		sampleAVX2(x, y, out, n, seed);
+		break;
+	case KERNEL_SSE2:
+		sampleSSE2(x, y, out, n, seed);
+		break;
+#endif
+	default:
+		for (std::size_t i = 0; i < n; ++i)
+			out[i] = noiseScalar(x[i], y[i], seed);
+		break;
+	}
+}
+SimplexNoise::Kernel SimplexNoise::bestKernel() noexcept
+{
+#ifdef FABRICA_NOISE_X86
+	if (__builtin_cpu_supports("avx2"))
+		return KERNEL_AVX2;
+	return KERNEL_SSE2;
+#else
+	return KERNEL_SCALAR;
+#endif
+}
+
+} // namespace fab
@@ -0,0 +1,70 @@
+#ifndef FABRICA_WORLD_GEN_SIMPLEXNOISE_HPP_
+#define FABRICA_WORLD_GEN_SIMPLEXNOISE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fab
+{
+
+/**
+ * @brief Seeded 2D simplex noise.
+ *
+ * The corner gradients are picked from an integer hash of the lattice point
+ * and the seed, so no permutation table is needed and the noise is
+ * vectorised without gathers.
+ *
+ * {@code sample(x, y, out, n)} evaluates 8 samples at a time with AVX2 if the
+ * processor supports it, 2x4 samples with SSE2 otherwise. All kernels perform
+ * the same single precision operations in the same order, so the output is
+ * bitwise identical regardless of the kernel (and thread) used.
+ *
+ * Output is approximately in [-1, 1].
+ */
+class SimplexNoise final
+{
+public:
+	enum Kernel: std::uint8_t
+	{
+		KERNEL_SCALAR = 0,
+		KERNEL_SSE2,
+		KERNEL_AVX2
+	};
+
+	SimplexNoise(std::uint32_t seed = 0) noexcept: seed(seed) {}
+
+	std::uint32_t getSeed() const noexcept { return seed; }
+
+	/**
+	 * @brief Evaluates the noise at a single point.
+	 */
+	float sample(float x, float y) const noexcept;
+	/**
+	 * @brief Evaluates the noise at n points.
+	 * @param[in] x X coordinates, n entries
+	 * @param[in] y Y coordinates, n entries
+	 * @param[out] out Results, n entries
+	 * @param[in] n Number of points
+	 */
+	void sample(float const* x, float const* y, float* out,
+	            std::size_t n) const noexcept;
+	/**
+	 * @brief Same as {@code sample(x, y, out, n)} but forces a kernel.
+	 * @warning If the processor does not support the kernel, the best
+	 *  supported kernel is used instead.
+	 */
+	void sample(float const* x, float const* y, float* out,
+	            std::size_t n, Kernel kernel) const noexcept;
+
+	/**
+	 * @brief The fastest kernel supported by this processor.
+	 */
+	static Kernel bestKernel() noexcept;
+
+private:
+	std::uint32_t seed;
+};
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_GEN_SIMPLEXNOISE_HPP_
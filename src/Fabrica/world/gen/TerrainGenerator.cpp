@@ -0,0 +1,80 @@
+#include "TerrainGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace fab
+{
+
+constexpr int const TerrainGenerator::nOctaves;
+
+TerrainGenerator::TerrainGenerator(std::uint32_t seed, Block* fill) noexcept:
+	baseHeight(8), amplitude(6), frequency(1.f / 64.f),
+	seed(seed), fill(fill)
+{
+	// Each octave has its own seed so that they do not correlate.
+	for (int i = 0; i < nOctaves; ++i)
+		octaves[i] = SimplexNoise(seed + 0x9e3779b9u * (i + 1));
+}
+
+void TerrainGenerator::heightmap(int chunkX, int chunkZ, int* const heights,
+                                 int maxHeight) const noexcept
+{
+	int const n = Chunk::size * Chunk::size;
+	float x[n], z[n], sample[n], sum[n];
+	std::fill(sum, sum + n, 0.f);
+
+	float freq = frequency;
+	float amp = 1.f;
+	float ampTotal = 0.f;
+	for (int o = 0; o < nOctaves; ++o)
+	{
+		for (int i = 0; i < Chunk::size; ++i)
+			for (int k = 0; k < Chunk::size; ++k)
+			{
+				x[i * Chunk::size + k] = (chunkX * Chunk::size + i) * freq;
+				z[i * Chunk::size + k] = (chunkZ * Chunk::size + k) * freq;
+			}
+		octaves[o].sample(x, z, sample, n);
+		for (int i = 0; i < n; ++i)
+			sum[i] += sample[i] * amp;
+
+		ampTotal += amp;
+		freq *= 2.f;
+		amp *= .5f;
+	}
+
+	float const factor = amplitude / ampTotal;
+	for (int i = 0; i < n; ++i)
+	{
+		int h = baseHeight + (int) std::floor(sum[i] * factor);
+		heights[i] = std::max(1, std::min(h, maxHeight));
+	}
+}
+void TerrainGenerator::generateColumn(int chunkX, int chunkZ,
+                                      Chunk* const* sections,
+                                      int nSections) const
+{
+	int heights[Chunk::size * Chunk::size];
+	heightmap(chunkX, chunkZ, heights, nSections * Chunk::size);
+
+	Block* const air = &BlockNull::instance;
+	for (int s = 0; s < nSections; ++s)
+	{
+		// Written directly and counted once, rather than block by block
+		Chunk* const c = sections[s];
+		int const base = s * Chunk::size;
+		for (int i = 0; i < Chunk::size; ++i)
+			for (int j = 0; j < Chunk::size; ++j)
+			{
+				Block** const row = c->blocks[i][j];
+				int const* const h = heights + i * Chunk::size;
+				for (int k = 0; k < Chunk::size; ++k)
+					row[k] = base + j < h[k] ? fill : air;
+			}
+		c->recount();
+		c->touch();
+	}
+}
+
+} // namespace fab
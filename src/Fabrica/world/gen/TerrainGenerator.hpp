@@ -0,0 +1,65 @@
+#ifndef FABRICA_WORLD_GEN_TERRAINGENERATOR_HPP_
+#define FABRICA_WORLD_GEN_TERRAINGENERATOR_HPP_
+
+#include <cstdint>
+
+#include "SimplexNoise.hpp"
+#include "../chunk/Chunk.hpp"
+
+namespace fab
+{
+
+/**
+ * @brief Generates terrain from a seed.
+ *
+ * The terrain is a heightmap built from several octaves of
+ * {@code SimplexNoise}. The heightmap is evaluated once per chunk column
+ * (16x16 samples per octave, in batches of 8) and then used to fill all the
+ * vertical sections of the column.
+ *
+ * The output depends only on the seed and the column coordinates, so columns
+ * can be generated in any order and on any number of threads.
+ */
+class TerrainGenerator final
+{
+public:
+	static constexpr int const nOctaves = 4;
+
+	/**
+	 * @param[in] seed World seed
+	 * @param[in] fill Block placed below the surface
+	 */
+	TerrainGenerator(std::uint32_t seed, Block* fill) noexcept;
+
+	std::uint32_t getSeed() const noexcept { return seed; }
+
+	/**
+	 * @brief Computes the terrain height of a chunk column.
+	 * @param[out] heights 16x16 array, indexed by [x * Chunk::size + z]. Each
+	 *  height is the number of filled blocks in the column.
+	 * @param[in] maxHeight Heights are clamped to [1, maxHeight]
+	 */
+	void heightmap(int chunkX, int chunkZ, int* const heights,
+	               int maxHeight) const noexcept;
+	/**
+	 * @brief Fills a chunk column.
+	 * @param[out] sections nSections chunks, from bottom to top. Every block is
+	 *  overwritten, and each section is touched once.
+	 */
+	void generateColumn(int chunkX, int chunkZ,
+	                    Chunk* const* sections, int nSections) const;
+
+	// Shape of the terrain
+	int baseHeight; ///< Mean height of the surface
+	int amplitude; ///< Maximum deviation of the surface from baseHeight
+	float frequency; ///< Frequency of the first octave, in 1/blocks
+
+private:
+	std::uint32_t seed;
+	Block* fill;
+	SimplexNoise octaves[nOctaves];
+};
+
+} // namespace fab
+
+#endif // !FABRICA_WORLD_GEN_TERRAINGENERATOR_HPP_